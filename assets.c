@@ -1,82 +1,102 @@
+/* Generato da tools/convert_images.py.
+ * Non modificare a mano: rigenerare con lo script.
+ */
 #include "assets.h"
 
-const unsigned char win_image[] = {
-  0x07, 0xff, 0xe0, 0x07, 0xff, 0xe0, 0x07, 0xff,
-  0xe0, 0x07, 0xff, 0xe0, 0x07, 0xff, 0xe0, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xc7, 0xff, 0xe3,
-  0xc7, 0xff, 0xe3, 0x3f, 0xff, 0xfc, 0x3f, 0xff,
-  0xfc, 0x3f, 0xff, 0xfc, 0x01, 0xff, 0x00, 0x01,
-  0xff, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x7c, 0x00,
-  0x00, 0x7c, 0x00, 0x00, 0x7c, 0x00, 0x00, 0x7c,
-  0x00, 0x01, 0xff, 0x00, 0x01, 0xff, 0x00,
+const unsigned char snake_image[SNAKE_RES_X*IMAGE_PAGES(SNAKE_RES_Y)] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x80, 0x80, 0x80, 0x40, 0xc0,
+  0x40, 0xa0, 0x60, 0xa0, 0x60, 0xa0, 0x60, 0xa0,
+  0xe0, 0x40, 0x60, 0x78, 0x54, 0x34, 0x08, 0x08,
+  0x44, 0x24, 0x32, 0x2b, 0x25, 0x3d, 0x1a, 0x44,
+  0x44, 0xc4, 0x44, 0x04, 0x18, 0x60, 0xc0, 0x80,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x80, 0x80, 0x80, 0xe0, 0xd8, 0xec,
+  0x56, 0xab, 0x75, 0xea, 0x75, 0x9a, 0x8d, 0x86,
+  0x85, 0x06, 0x07, 0x02, 0x03, 0x02, 0x01, 0x07,
+  0x1d, 0x25, 0x39, 0x89, 0x49, 0xf9, 0x39, 0x89,
+  0x5a, 0x24, 0x3c, 0x0e, 0x86, 0xc2, 0x62, 0x32,
+  0x1f, 0x83, 0x47, 0x25, 0x1b, 0x15, 0x8b, 0x4d,
+  0x4b, 0x4d, 0x4a, 0x4c, 0x48, 0x48, 0x48, 0x88,
+  0x10, 0x10, 0x20, 0x40, 0xc0, 0x60, 0xd0, 0x90,
+  0x20, 0x20, 0x40, 0x80, 0x00, 0x00, 0x00, 0x00,
+  0x18, 0x2f, 0x35, 0x2e, 0x35, 0x2e, 0x3d, 0x7a,
+  0x57, 0xed, 0xd9, 0xed, 0xdf, 0xae, 0xd5, 0xaf,
+  0x75, 0xaf, 0x74, 0xa8, 0x78, 0xb0, 0xe0, 0x00,
+  0xc0, 0x20, 0x10, 0x08, 0x04, 0xc2, 0x61, 0x30,
+  0x98, 0xcc, 0xe6, 0xf3, 0xf1, 0xc0, 0x38, 0x46,
+  0x81, 0x00, 0x18, 0x24, 0x42, 0x81, 0x38, 0x6c,
+  0x94, 0x66, 0x46, 0x4a, 0x8a, 0x8e, 0x8c, 0x8e,
+  0x8b, 0x88, 0x48, 0x48, 0x47, 0xae, 0x57, 0xef,
+  0xff, 0xfc, 0xf0, 0x01, 0x06, 0xfa, 0x0c, 0x00,
+  0x0c, 0x1e, 0x3e, 0x3f, 0x7f, 0x7f, 0x7f, 0x7f,
+  0x7e, 0x7e, 0x7c, 0xf0, 0xf7, 0xf4, 0xe3, 0xe3,
+  0xeb, 0xe7, 0xeb, 0xe7, 0xe5, 0xe3, 0xe0, 0xce,
+  0x91, 0xb0, 0x20, 0x40, 0x46, 0x43, 0x84, 0x85,
+  0x89, 0x8b, 0x8b, 0x8b, 0x8b, 0x8b, 0x8b, 0x8a,
+  0x88, 0x89, 0x8a, 0x44, 0x42, 0x40, 0x41, 0x36,
+  0x9c, 0xc1, 0xde, 0x92, 0x94, 0xa4, 0xa4, 0xa4,
+  0xa4, 0xa4, 0x92, 0xd2, 0xd6, 0x4a, 0x6d, 0x67,
+  0x69, 0x6b, 0x6f, 0x68, 0x28, 0x27, 0x10, 0x00,
 };
 
-const unsigned char snake_image[SNAKE_RES_X*SNAKE_RES_Y] = {
-  0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x32, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0xcd, 0xf0,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x13, 0x16,
-  0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c,
-  0x26, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7f,
-  0xb4, 0x7c, 0x04, 0x00, 0x00, 0x00, 0x00, 0x03,
-  0xaa, 0xf8, 0x81, 0xe6, 0x00, 0x00, 0x00, 0x00,
-  0x1d, 0x55, 0x80, 0x00, 0x43, 0x00, 0x00, 0x00,
-  0x00, 0x6a, 0xab, 0xff, 0x00, 0xff, 0xc0, 0x00,
-  0x00, 0x00, 0xd5, 0x7d, 0x00, 0x9f, 0xea, 0xa0,
-  0x00, 0x00, 0x01, 0xab, 0xe1, 0xc0, 0x78, 0xb5,
-  0x50, 0x00, 0x00, 0x03, 0x56, 0x00, 0xbf, 0xb0,
-  0x8b, 0xff, 0x00, 0x00, 0x02, 0xac, 0x00, 0xa6,
-  0xa1, 0x8c, 0x00, 0xc3, 0x00, 0x05, 0x78, 0x00,
-  0x66, 0x63, 0x10, 0x00, 0x24, 0xc0, 0x07, 0xb8,
-  0x00, 0x0c, 0x86, 0x21, 0xfe, 0x1e, 0x20, 0x3f,
-  0x57, 0x80, 0x15, 0x0c, 0x42, 0x01, 0x0b, 0x10,
-  0x6a, 0xfb, 0xc0, 0x02, 0x18, 0x84, 0x00, 0x8b,
-  0x90, 0x55, 0x8d, 0x40, 0x04, 0x31, 0x08, 0x7d,
-  0x8f, 0x8c, 0x7e, 0xdf, 0xe0, 0x08, 0x61, 0x11,
-  0xe7, 0x0f, 0xca, 0xd7, 0x7d, 0x58, 0x10, 0xc2,
-  0x23, 0x1f, 0xf5, 0xc6, 0xab, 0xaa, 0xac, 0x21,
-  0x9a, 0x22, 0x80, 0x02, 0xe4, 0x7f, 0x55, 0xfe,
-  0x43, 0x3a, 0x13, 0x40, 0x05, 0xe4, 0x01, 0xfa,
-  0xaa, 0x86, 0x7d, 0x09, 0x70, 0x3b, 0xe4, 0x00,
-  0x7f, 0x56, 0x84, 0xfc, 0x84, 0x8f, 0xc5, 0xe4,
-  0x1f, 0x0b, 0xfc, 0x85, 0xfe, 0x42, 0x40, 0x03,
-  0xe4, 0x7f, 0xcb, 0xf5, 0x0c, 0x7f, 0x29, 0x30,
-  0x3d, 0x64, 0xff, 0xec, 0x59, 0x0b, 0x00, 0x11,
-  0xaf, 0xcb, 0x24, 0xff, 0xe0, 0xa1, 0x00, 0xff,
-  0xe0, 0xa0, 0x06, 0xf8, 0x7f, 0xfc, 0x00, 0xc0,
-  0x00, 0x01, 0xb8, 0x38, 0x02, 0x3f, 0xff, 0xfe,
-  0x60, 0x00, 0x01, 0x07, 0xc3, 0xfc, 0x0f, 0xff,
-  0xff, 0x1c, 0x00, 0x1e, 0x60, 0x1f, 0xf0, 0x00,
-  0x1f, 0xff, 0xc3, 0xff, 0xe0, 0xff, 0xf8, 0x00,
+const unsigned char game_over_image[GAME_OVER_RES_X*IMAGE_PAGES(GAME_OVER_RES_Y)] = {
+  0x78, 0x78, 0xfc, 0x87, 0x03, 0x03, 0x33, 0xf3,
+  0xf3, 0xf3, 0x03, 0xfb, 0xfc, 0x67, 0x47, 0x43,
+  0x47, 0xfc, 0xfc, 0xf8, 0x00, 0xff, 0xff, 0xff,
+  0x3c, 0x78, 0x78, 0x3c, 0xff, 0xff, 0xff, 0x00,
+  0xff, 0xff, 0xff, 0x33, 0x33, 0x33, 0x33, 0x33,
+  0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0xfc, 0xff, 0x03, 0x03, 0x03, 0x03, 0xff, 0xff,
+  0xfc, 0x00, 0x3f, 0x3f, 0x7f, 0xf0, 0xc0, 0xe0,
+  0xf0, 0x7f, 0x3f, 0x00, 0x00, 0xff, 0xff, 0x33,
+  0x33, 0x33, 0x33, 0x33, 0x33, 0x03, 0x00, 0xff,
+  0xff, 0xff, 0x43, 0xc3, 0xe3, 0xf3, 0xbf, 0x3c,
+  0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00,
+  0x00, 0x00, 0x01, 0x01, 0x01, 0x00, 0x01, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01,
+  0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+  0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01,
+  0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+  0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01,
+  0x01, 0x00,
 };
 
-const unsigned char game_over_image[GAME_OVER_RES_X*GAME_OVER_RES_Y] = {
-  0x1f, 0xf7, 0x87, 0x0e, 0xff, 0x80, 0x7f, 0x38, 0x67, 0xfd, 0xfe, 0x00,
-  0x1f, 0xf7, 0x87, 0x0e, 0xff, 0x80, 0x7f, 0x38, 0x67, 0xfd, 0xfe, 0x00,
-  0x30, 0x0e, 0xe7, 0x9e, 0xe0, 0x00, 0xc3, 0xb8, 0x66, 0x01, 0xc3, 0x01,
-  0xe0, 0x18, 0x77, 0xfe, 0xe0, 0x00, 0xc3, 0xb8, 0x66, 0x01, 0xc3, 0x01,
-  0xe3, 0xd8, 0x77, 0xfe, 0xff, 0x00, 0xc3, 0xbc, 0xe7, 0xf9, 0xc7, 0x01,
-  0xe3, 0xdc, 0x77, 0xfe, 0xff, 0x00, 0xc3, 0xbd, 0xe7, 0xf9, 0xcf, 0x00,
-  0xe1, 0xdf, 0xf7, 0x6e, 0xe0, 0x00, 0xc3, 0x8f, 0xc6, 0x01, 0xfc, 0x00,
-  0x31, 0xd8, 0x77, 0x0e, 0xe0, 0x00, 0xc3, 0x87, 0x86, 0x01, 0xde, 0x00,
-  0x1f, 0xd8, 0x77, 0x0e, 0xff, 0x80, 0x7f, 0x03, 0x07, 0xfd, 0xc7, 0x01};
+const unsigned char title_image[TITLE_RES_X*IMAGE_PAGES(TITLE_RES_Y)] = {
+  0x00, 0x00, 0xe0, 0xf0, 0xf8, 0xfc, 0x7e, 0x7e,
+  0x30, 0x00, 0x00, 0xf0, 0xf0, 0xf8, 0xf8, 0x80,
+  0x00, 0xe0, 0xf8, 0xfc, 0xfc, 0x00, 0x80, 0xe0,
+  0xf0, 0xf8, 0xfe, 0xfc, 0x80, 0x00, 0x08, 0x3e,
+  0xfe, 0xfe, 0x80, 0x80, 0xc0, 0xf8, 0xfc, 0x3c,
+  0x00, 0xd8, 0xe2, 0x3f, 0xbf, 0x8f, 0x78, 0x7f,
+  0x7f, 0x73, 0x71, 0x30, 0xb8, 0xf8, 0xf8, 0xf8,
+  0xf0, 0x07, 0xff, 0xff, 0x17, 0x1f, 0x78, 0xff,
+  0xff, 0x7f, 0x1f, 0xc0, 0xff, 0xff, 0x7f, 0x70,
+  0x30, 0xff, 0xff, 0xfe, 0xcf, 0x0f, 0xf1, 0xff,
+  0xff, 0x3f, 0x7f, 0xe3, 0xc0, 0x03, 0x00, 0x1f,
+  0x7f, 0xff, 0xc7, 0xe3, 0x00, 0x0c, 0x3c, 0x3e,
+  0x1f, 0x1f, 0x0f, 0x07, 0x03, 0x01, 0x00, 0x03,
+  0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x03, 0x03, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x03, 0x00,
+  0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x03,
+  0x01, 0x00,
+};
 
-const unsigned char title_image[TITLE_RES_X*TITLE_RES_Y] = {
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x03, 0x00,
-  0x00, 0x21, 0xc0, 0x3e, 0x07, 0x00, 0x18, 0x31,
-  0xc3, 0x1f, 0x0f, 0x06, 0x38, 0x73, 0xc7, 0x5f,
-  0x1f, 0x9e, 0x38, 0xf1, 0xc7, 0x58, 0x3f, 0x9e,
-  0x79, 0xf1, 0xc7, 0x38, 0x3f, 0x1e, 0x79, 0xf0,
-  0xce, 0x60, 0x3c, 0x1f, 0x7b, 0xf8, 0xfe, 0x6c,
-  0x78, 0x1f, 0x7b, 0x9b, 0xfd, 0x7c, 0x70, 0x1f,
-  0x7b, 0x9f, 0x7d, 0x7c, 0x60, 0x1f, 0x7b, 0x9f,
-  0x78, 0x78, 0xe3, 0xcd, 0xfb, 0x9f, 0x78, 0x73,
-  0xff, 0xef, 0xfb, 0xfc, 0xf8, 0x73, 0xff, 0xec,
-  0xf3, 0xfc, 0xfc, 0x37, 0xf9, 0xec, 0xf7, 0xde,
-  0xee, 0x3e, 0x03, 0xec, 0x67, 0x1e, 0xe6, 0x1e,
-  0x0f, 0xdc, 0x0f, 0x00, 0x62, 0x18, 0x1f, 0x90,
-  0x0e, 0x00, 0x60, 0x10, 0x7f, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x7e, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00,
-  0x00, 0x00, 0x00, 0x00
+const unsigned char win_image[WIN_RES_X*IMAGE_PAGES(WIN_RES_Y)] = {
+  0xe0, 0xe0, 0x60, 0x60, 0x60, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0x60, 0x60, 0x60, 0xe0, 0xe0,
+  0x01, 0x01, 0x0e, 0x0e, 0x0e, 0x0f, 0x0f, 0x3f,
+  0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f, 0x3f,
+  0x0f, 0x0f, 0x0f, 0x0e, 0x0e, 0x0e, 0x01, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08,
+  0x08, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x08, 0x08,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 };
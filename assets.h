@@ -1,6 +1,12 @@
+/* Generato da tools/convert_images.py.
+ * Non modificare a mano: rigenerare con lo script.
+ */
 #ifndef ASSETS_H
 #define ASSETS_H
 
+// Numero di pagine (gruppi di 8 righe) di un'immagine alta h pixel.
+#define IMAGE_PAGES(h) (((h) + 7) / 8)
+
 #define SNAKE_RES_X 72
 #define SNAKE_RES_Y 32
 #define GAME_OVER_RES_X 89
@@ -9,8 +15,8 @@
 #define TITLE_RES_Y 22
 #define WIN_RES_X 24
 #define WIN_RES_Y 20
-extern const unsigned char win_image[];
-extern const unsigned char title_image[TITLE_RES_X*TITLE_RES_Y];
-extern const unsigned char snake_image[SNAKE_RES_X*SNAKE_RES_Y];
-extern const unsigned char game_over_image[GAME_OVER_RES_X*GAME_OVER_RES_Y];
+extern const unsigned char snake_image[SNAKE_RES_X*IMAGE_PAGES(SNAKE_RES_Y)];
+extern const unsigned char game_over_image[GAME_OVER_RES_X*IMAGE_PAGES(GAME_OVER_RES_Y)];
+extern const unsigned char title_image[TITLE_RES_X*IMAGE_PAGES(TITLE_RES_Y)];
+extern const unsigned char win_image[WIN_RES_X*IMAGE_PAGES(WIN_RES_Y)];
 #endif
@@ -0,0 +1,82 @@
+#include "budget.h"
+#include "hal.h"
+#include "logger.h"
+
+/* Symbol: AIBudget_init
+ *   Inizializza il budget con [frame_budget_us] microsecondi
+ *   per frame, da dividere tra i giocatori registrati.
+ */
+void AIBudget_init(AIBudget *budget, uint32_t frame_budget_us)
+{
+  budget->frame_budget = US2RTC(STM32_HCLK, frame_budget_us);
+  budget->bot_count = 0;
+  budget->slice = budget->frame_budget;
+  budget->stop = budget->slice - budget->slice / 4;
+}
+
+/* Symbol: AIBudget_register
+ *   Aggiunge un giocatore al budget e ne ritorna l'indice,
+ *   oppure -1 se ci sono già MAX_PLAYERS_PER_GAME giocatori.
+ *   La parte di ogni giocatore è ricalcolata.
+ */
+int AIBudget_register(AIBudget *budget)
+{
+  if (budget->bot_count == MAX_PLAYERS_PER_GAME) {
+    Logger_printf("ERROR :: Too many players for the AI budget");
+    return -1;
+  }
+
+  int bot = budget->bot_count++;
+  budget->decisions[bot] = 0;
+  budget->overruns[bot] = 0;
+  budget->used[bot] = 0;
+  budget->slice = budget->frame_budget / budget->bot_count;
+  budget->stop = budget->slice - budget->slice / 4;
+  return bot;
+}
+
+void AIBudget_begin(AIBudget *budget, int bot)
+{
+  budget->start[bot] = chSysGetRealtimeCounterX();
+}
+
+/* Symbol: AIBudget_expired
+ *   Ritorna 1 se il giocatore [bot] deve fermarsi, cioè se
+ *   dall'ultima [AIBudget_begin] ha usato 3/4 della sua parte
+ *   del frame.
+ *
+ * Nota: Il contatore è a 32 bit, ma la differenza senza segno
+ *       resta corretta anche quando si azzera, finché una
+ *       decisione dura meno di un giro (circa 51 secondi a
+ *       84MHz).
+ */
+_Bool AIBudget_expired(AIBudget *budget, int bot)
+{
+  return (rtcnt_t) (chSysGetRealtimeCounterX() - budget->start[bot]) >= budget->stop;
+}
+
+void AIBudget_end(AIBudget *budget, int bot)
+{
+  rtcnt_t elapsed = chSysGetRealtimeCounterX() - budget->start[bot];
+  budget->decisions[bot]++;
+  budget->used[bot] += elapsed;
+  if (elapsed > budget->slice)
+    budget->overruns[bot]++;
+}
+
+uint32_t AIBudget_getSliceMicroseconds(AIBudget *budget)
+{
+  return RTC2US(STM32_HCLK, budget->slice);
+}
+
+uint32_t AIBudget_getOverruns(AIBudget *budget, int bot)
+{
+  return budget->overruns[bot];
+}
+
+uint32_t AIBudget_getMeanMicroseconds(AIBudget *budget, int bot)
+{
+  if (budget->decisions[bot] == 0)
+    return 0;
+  return budget->used[bot] / budget->decisions[bot] / (STM32_HCLK / 1000000);
+}
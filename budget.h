@@ -0,0 +1,51 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdint.h>
+#include "ch.h"
+#include "config.h"
+
+/* Symbol: AIBudget
+ *   Divide il tempo di CPU che i giocatori artificiali possono
+ *   usare ad ogni frame (AI_FRAME_BUDGET_US) in parti uguali
+ *   tra i giocatori registrati con [AIBudget_register]. Il
+ *   tempo è misurato col contatore realtime di ChibiOS, che
+ *   sugli STM32 è il contatore di cicli del DWT.
+ *
+ *   Un giocatore chiama [AIBudget_begin] prima di decidere,
+ *   [AIBudget_expired] durante la decisione per sapere se deve
+ *   fermarsi, ed [AIBudget_end] alla fine. Le decisioni che
+ *   superano la propria parte sono contate come sforamenti.
+ *
+ *   [AIBudget_expired] diventa vero già a 3/4 della parte:
+ *   il resto serve a chiudere la ricerca interrotta ed a
+ *   finire la decisione senza sforare.
+ *
+ *   Aggiungendo giocatori la parte di ciascuno diminuisce,
+ *   quindi i giocatori che possono interrompersi (vedi
+ *   [SearchJoystick]) cercano meno a fondo invece di
+ *   allungare il frame.
+ */
+typedef struct AIBudget AIBudget;
+struct AIBudget {
+  rtcnt_t frame_budget;
+  int     bot_count;
+  rtcnt_t slice;
+  rtcnt_t stop;
+
+  rtcnt_t  start[MAX_PLAYERS_PER_GAME];
+  uint32_t decisions[MAX_PLAYERS_PER_GAME];
+  uint32_t overruns[MAX_PLAYERS_PER_GAME];
+  uint64_t used[MAX_PLAYERS_PER_GAME];
+};
+
+void     AIBudget_init(AIBudget *budget, uint32_t frame_budget_us);
+int      AIBudget_register(AIBudget *budget);
+void     AIBudget_begin(AIBudget *budget, int bot);
+_Bool    AIBudget_expired(AIBudget *budget, int bot);
+void     AIBudget_end(AIBudget *budget, int bot);
+uint32_t AIBudget_getSliceMicroseconds(AIBudget *budget);
+uint32_t AIBudget_getOverruns(AIBudget *budget, int bot);
+uint32_t AIBudget_getMeanMicroseconds(AIBudget *budget, int bot);
+
+#endif /* BUDGET_H */
@@ -15,8 +15,157 @@
 #warning "Non sar possibile allocare i serpenti necessari a creare una partita col numero massimo di giocatori"
 #endif
 
+// Numero massimo di celle della griglia di gioco
+// (Display_getWidth() * Display_getHeight()). Le
+// strutture del modello del mondo (world.h) sono
+// dimensionate staticamente su questo valore. Il
+// default corrisponde alla risoluzione 4x4.
+#ifndef MAX_BOARD_CELLS
+#define MAX_BOARD_CELLS 512
+#endif
+
+// Lunghezza massima del corpo di un serpente (testa
+// esclusa). Di default un serpente pu riempire tutta
+// la griglia, che  la condizione di vittoria delle
+// partite con un solo giocatore.
 #ifndef MAX_SNAKE_LEN
-#define MAX_SNAKE_LEN 32
+#define MAX_SNAKE_LEN MAX_BOARD_CELLS
 #endif
 
 #define NOLOGGING
+
+// Se definito, nella modalit CLASSIC il serpente 
+// guidato dal giocatore artificiale basato sul ciclo
+// hamiltoniano invece che dal joystick fisico. Serve
+// per mettere sotto stress il gioco con serpenti
+// della lunghezza massima.
+//#define CLASSIC_AI_PLAYER
+
+// Se definito, all'avvio invece del men viene eseguito
+// il torneo tra giocatori artificiali di tournament.c,
+// che stampa i risultati in formato CSV sulla seriale.
+// Lo definisce il Makefile con "make USE_TOURNAMENT=yes",
+// insieme a SSD1306_USE_PANEL_MODEL: il driver non vede
+// questo file, e senza il modello del pannello il torneo
+// non controllerebbe gli aggiornamenti del display.
+#if defined(TOURNAMENT_MODE) && !defined(SSD1306_USE_PANEL_MODEL)
+#error "Il torneo va compilato con make USE_TOURNAMENT=yes"
+#endif
+
+#ifndef MAX_AI_WORKERS
+#define MAX_AI_WORKERS 2
+#endif
+
+#ifndef AI_WORKER_STACK_SIZE
+#define AI_WORKER_STACK_SIZE 1024
+#endif
+
+// Priorit dei thread che calcolano le mosse dei
+// giocatori artificiali. Deve essere minore di quella
+// del thread che esegue [Game_play] (NORMALPRIO),
+// altrimenti l'IA ruberebbe tempo al tick del gioco.
+#ifndef AI_WORKER_PRIO
+#define AI_WORKER_PRIO (NORMALPRIO-1)
+#endif
+
+// Se 1, [Display_update] affida l'invio del frame ad un
+// thread e ritorna subito, cos la logica del tick
+// successivo procede mentre i byte sono sul bus I2C.
+#ifndef DISPLAY_ASYNC_UPDATE
+#define DISPLAY_ASYNC_UPDATE 1
+#endif
+
+// Priorit del thread che invia i frame al display.
+// Passa quasi tutto il tempo in attesa del DMA, quindi
+// pu stare sopra a quello del gioco (NORMALPRIO) per
+// far partire il trasferimento appena richiesto.
+#ifndef DISPLAY_FLUSH_PRIO
+#define DISPLAY_FLUSH_PRIO (NORMALPRIO+1)
+#endif
+
+#ifndef DISPLAY_FLUSH_STACK_SIZE
+#define DISPLAY_FLUSH_STACK_SIZE 768
+#endif
+
+// Numero massimo di giocatori artificiali con percorso
+// pianificato (joystick_path.c) contemporaneamente.
+#ifndef MAX_PATH_PLANS
+#define MAX_PATH_PLANS 2
+#endif
+
+// Numero di mosse future esplorate dal giocatore
+// artificiale con ricerca (joystick_search.c).
+#ifndef AI_SEARCH_DEPTH
+#define AI_SEARCH_DEPTH 7
+#endif
+
+// Numeri casuali generati alla volta da ogni
+// RandomJoystick (joystick_random.c).
+#ifndef RANDOM_JOYSTICK_BATCH
+#define RANDOM_JOYSTICK_BATCH 16
+#endif
+
+// Numero massimo di thread tra cui il giocatore artificiale
+// con ricerca pu dividere una ricerca (vedi
+// [SearchJoystick_setWorkers]). Valori maggiori di 1 sono
+// supportati solo compilando per Linux (tornei ed analisi
+// sull'host).
+#ifndef AI_SEARCH_WORKERS
+#define AI_SEARCH_WORKERS 1
+#endif
+
+// Tempo di CPU (in microsecondi) che i giocatori
+// artificiali con un [AIBudget] possono usare in tutto
+// ad ogni frame (vedi budget.c).
+#ifndef AI_FRAME_BUDGET_US
+#define AI_FRAME_BUDGET_US 2000
+#endif
+
+// Stack (in byte) usato nel caso peggiore da un thread
+// dei giocatori artificiali, dal thread che invia i frame
+// al display e dal processo principale, compresa la
+// decisione pi costosa: come il budget limita il tempo
+// di una decisione, questi valori ne limitano lo spazio.
+// Misurati con tools/stack_usage.py su una build a 32 bit
+// a -O0, contando 128 byte per ogni chiamata a ChibiOS o
+// alla libreria C. Vanno aggiornati quando cambiano, e
+// gli stack sono controllati qui sotto (il Makefile passa
+// la dimensione dello stack principale come
+// PROCESS_STACK_SIZE).
+#define AI_WORKER_STACK_USAGE     640
+#define DISPLAY_FLUSH_STACK_USAGE 576
+#ifdef TOURNAMENT_MODE
+#define MAIN_STACK_USAGE 1472
+#else
+#define MAIN_STACK_USAGE 1808
+#endif
+
+#if AI_WORKER_STACK_SIZE < AI_WORKER_STACK_USAGE
+#error "AI_WORKER_STACK_SIZE  minore di AI_WORKER_STACK_USAGE"
+#endif
+
+#if DISPLAY_FLUSH_STACK_SIZE < DISPLAY_FLUSH_STACK_USAGE
+#error "DISPLAY_FLUSH_STACK_SIZE  minore di DISPLAY_FLUSH_STACK_USAGE"
+#endif
+
+#if defined(PROCESS_STACK_SIZE) && PROCESS_STACK_SIZE < MAIN_STACK_USAGE
+#error "Lo stack principale (USE_PROCESS_STACKSIZE nel Makefile)  minore di MAIN_STACK_USAGE"
+#endif
+
+// Il risolutore esatto del finale (endgame.c) viene
+// usato solo quando il serpente  rimasto solo in gioco e
+// restano al pi ENDGAME_MAX_FREE_CELLS celle libere, e si
+// arrende dopo ENDGAME_MAX_NODES nodi.
+#ifndef ENDGAME_MAX_FREE_CELLS
+#define ENDGAME_MAX_FREE_CELLS 24
+#endif
+
+#ifndef ENDGAME_MAX_NODES
+#define ENDGAME_MAX_NODES 2048
+#endif
+
+// Numero di elementi della tabella delle trasposizioni
+// (transposition.c). Deve essere una potenza di 2.
+#ifndef TT_ENTRIES
+#define TT_ENTRIES 512
+#endif
@@ -1,3 +1,6 @@
+#include "ch.h"
+#include "hal.h"
+#include "config.h"
 #include "logger.h"
 #include "display.h"
 #include "ssd1306.h"
@@ -7,10 +10,45 @@ typedef struct {
   unsigned int y_resolution; // virtual pixel height
   unsigned int res_lock;
   SSD1306Driver SSD1306D1;
+
+  // Microsecondi passati ad aspettare il bus I2C
+  // (vedi [Display_getWaitMicroseconds]).
+  unsigned int wait_us;
+
+#if DISPLAY_ASYNC_UPDATE
+  // Vale 1 da [Display_update] fino alla fine
+  // dell'invio del frame da parte di [flushLoop].
+  volatile _Bool busy;
+  binary_semaphore_t flush_request;
+  binary_semaphore_t idle;
+#endif
 } Display;
 
 static Display display;
 
+#if DISPLAY_ASYNC_UPDATE
+static THD_WORKING_AREA(waFlushLoop, DISPLAY_FLUSH_STACK_SIZE);
+
+/* Symbol: flushLoop
+ *   Thread che invia i frame al display. Dorme finché
+ *   [Display_update] non gli chiede un invio, poi
+ *   trasmette il buffer frontale e segnala la fine su
+ *   [idle].
+ */
+static THD_FUNCTION(flushLoop, arg)
+{
+  (void) arg;
+  chRegSetThreadName("DisplayFlush");
+
+  while (1) {
+    chBSemWait(&display.flush_request);
+    ssd1306FlushScreen(&display.SSD1306D1);
+    display.busy = 0;
+    chBSemSignal(&display.idle);
+  }
+}
+#endif
+
 static void sanitizeResolution(unsigned int *x_res, unsigned int *y_res)
 {
   const unsigned int display_w = SSD1306_WIDTH;
@@ -33,6 +71,12 @@ void Display_changeResolution(unsigned int x_res,
   }
 }
 
+void Display_getResolution(unsigned int *x_res, unsigned int *y_res)
+{
+  *x_res = display.x_resolution;
+  *y_res = display.y_resolution;
+}
+
 void Display_lockResolution(void)
 {
   display.res_lock++;
@@ -62,6 +106,14 @@ void Display_init(void)
   static const I2CConfig i2ccfg = { OPMODE_I2C, 400000, FAST_DUTY_CYCLE_2 };
   static const SSD1306Config ssd1306cfg = { &I2CD1, &i2ccfg, SSD1306_SAD_0X78, };
   ssd1306Start(&display.SSD1306D1, &ssd1306cfg);
+
+#if DISPLAY_ASYNC_UPDATE
+  display.busy = 0;
+  chBSemObjectInit(&display.flush_request, 1);
+  chBSemObjectInit(&display.idle, 0);
+  chThdCreateStatic(waFlushLoop, sizeof(waFlushLoop),
+                    DISPLAY_FLUSH_PRIO, flushLoop, 0);
+#endif
 }
 
 unsigned int Display_getWidth(void)
@@ -74,19 +126,68 @@ unsigned int Display_getHeight(void)
   return SSD1306_HEIGHT / display.y_resolution;
 }
 
-static void Display_drawPhysicalPixel(int x, int y, Color color)
+static uint32_t cyclesToMicroseconds(rtcnt_t cycles)
 {
-  ssd1306DrawPixel(&display.SSD1306D1, x, y, color);
+  return cycles / (STM32_HCLK / 1000000);
 }
 
+/* Symbol: Display_waitIdle
+ *   Aspetta che il display abbia finito di ricevere l'ultimo
+ *   frame chiesto con [Display_update].
+ */
+void Display_waitIdle(void)
+{
+#if DISPLAY_ASYNC_UPDATE
+  if (!display.busy)
+    return;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  chBSemWait(&display.idle);
+  chBSemSignal(&display.idle);
+  display.wait_us += cyclesToMicroseconds(chSysGetRealtimeCounterX() - start);
+#endif
+}
+
+/* Symbol: Display_isIdle
+ *   Ritorna 1 se il display non sta ricevendo un frame,
+ *   cioè se [Display_update] non dovrà aspettare.
+ */
+_Bool Display_isIdle(void)
+{
+#if DISPLAY_ASYNC_UPDATE
+  return !display.busy;
+#else
+  return 1;
+#endif
+}
+
+/* Symbol: Display_getWaitMicroseconds
+ *   Ritorna il tempo totale (in microsecondi) passato ad
+ *   aspettare il bus del display: dentro [Display_update]
+ *   se l'aggiornamento è sincrono, dentro [Display_waitIdle]
+ *   se è asincrono.
+ */
+unsigned int Display_getWaitMicroseconds(void)
+{
+  return display.wait_us;
+}
+
+/* Symbol: Display_drawPixel
+ *   Colora un pixel virtuale, cioè un rettangolo di
+ *   x_resolution per y_resolution pixel del display. Il
+ *   driver lo riempie scrivendo per ogni colonna i bit di
+ *   tutte le sue righe in un colpo solo.
+ */
 void Display_drawPixel(int x, int y, Color color)
 {
-  for (int rel_x = 0; rel_x < (int) display.x_resolution; ++rel_x)
-    for (int rel_y = 0; rel_y < (int) display.y_resolution; ++rel_y)
-      ssd1306DrawPixel(&display.SSD1306D1,
-                       rel_x + x * display.x_resolution,
-                       rel_y + y * display.y_resolution,
-                       color);
+  int phys_x = x * (int) display.x_resolution;
+  int phys_y = y * (int) display.y_resolution;
+
+  if (x < 0 || y < 0 || phys_x >= SSD1306_WIDTH || phys_y >= SSD1306_HEIGHT)
+    return;
+
+  ssd1306FillRect(&display.SSD1306D1, phys_x, phys_y,
+                  display.x_resolution, display.y_resolution, color);
 }
 
 void Display_clear(Color color)
@@ -94,33 +195,88 @@ void Display_clear(Color color)
   ssd1306FillScreen(&display.SSD1306D1, color);
 }
 
+/* Symbol: Display_update
+ *   Invia al display il frame disegnato fin qui. Il driver ha
+ *   due framebuffer: si disegna sempre in quello posteriore,
+ *   che qui diventa quello frontale da trasmettere, e del
+ *   display vengono aggiornate solo le colonne diverse da
+ *   quelle che contiene già.
+ *
+ *   Con DISPLAY_ASYNC_UPDATE l'invio è fatto da [flushLoop] e
+ *   la funzione ritorna subito, quindi si può disegnare il
+ *   frame successivo durante il trasferimento. Aspetta solo se
+ *   il frame precedente non è ancora stato inviato. La fine
+ *   dell'invio si aspetta con [Display_waitIdle] o si
+ *   controlla con [Display_isIdle].
+ */
 void Display_update(void)
 {
+#if DISPLAY_ASYNC_UPDATE
+  Display_waitIdle();
+  ssd1306SwapBuffers(&display.SSD1306D1);
+  chBSemWait(&display.idle);
+  display.busy = 1;
+  chBSemSignal(&display.flush_request);
+#else
+  rtcnt_t start = chSysGetRealtimeCounterX();
   ssd1306UpdateScreen(&display.SSD1306D1);
+  display.wait_us += cyclesToMicroseconds(chSysGetRealtimeCounterX() - start);
+#endif
+}
+
+/* Symbol: Display_getBytesSent
+ *   Ritorna il numero di byte inviati al display sul bus I2C
+ *   dalla sua inizializzazione. Il driver invia solo le
+ *   pagine modificate dall'ultimo [Display_update], quindi la
+ *   differenza tra due chiamate misura il costo di un frame.
+ */
+unsigned int Display_getBytesSent(void)
+{
+  Display_waitIdle();
+  return ssd1306GetBytesSent(&display.SSD1306D1);
 }
 
+/* Symbol: Display_getTransfers
+ *   Ritorna il numero di transazioni I2C fatte dal driver
+ *   del display dalla sua inizializzazione. Ognuna costa
+ *   start, indirizzo e stop sul bus oltre ai propri byte.
+ */
+unsigned int Display_getTransfers(void)
+{
+  Display_waitIdle();
+  return ssd1306GetTransfers(&display.SSD1306D1);
+}
+
+#if SSD1306_USE_PANEL_MODEL
+/* Symbol: Display_isPanelSynced
+ *   Ritorna 1 se, dopo l'ultimo [Display_update], la RAM del
+ *   display (simulata dal driver) coincide con quella che
+ *   avrebbe scritto un aggiornamento completo.
+ */
+_Bool Display_isPanelSynced(void)
+{
+  Display_waitIdle();
+  return ssd1306PanelMatches(&display.SSD1306D1);
+}
+#endif
+
+/* Symbol: Display_drawImage
+ *   Disegna un'immagine di x_size per y_size pixel con
+ *   l'angolo in alto a sinistra in (x_off, y_off). L'immagine
+ *   è divisa in pagine di 8 righe come il framebuffer (vedi
+ *   tools/convert_images.py), quindi il driver la copia un
+ *   byte per colonna alla volta. I bit a 1 prendono il colore
+ *   [mode], quelli a 0 il colore opposto.
+ */
 void Display_drawImage(const unsigned char *image_bits,
                        int x_size, int y_size,
                        int x_off, int y_off, int mode)
 {
-  int x;
-  int y;
-  int i;
-
-  i = 0;
-  for (y = 0; y < y_size; ++y) {
-    for (x = 0; x < x_size; ++x) {
-      if (image_bits[i] & (1 << (7-(x%8)))) {
-        Display_drawPhysicalPixel(x + x_off, y + y_off, mode);
-      }
-      else {
-        Display_drawPhysicalPixel(x + x_off, y + y_off, !mode);
-      }
-
-      if (x+1 != x_size && ((x+1) % 8 == 0)) ++i;
-    }
-    ++i;
-  }
+  if (x_off < 0 || y_off < 0)
+    return;
+
+  ssd1306Blit(&display.SSD1306D1, image_bits, x_size, y_size,
+              x_off, y_off, mode);
 }
 
 void Display_drawText(const char *str, int x, int y, Color color)
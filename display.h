@@ -2,10 +2,17 @@ typedef int Color;
 void Display_init(void);
 void Display_clear(Color color);
 void Display_update(void);
+void Display_waitIdle(void);
+_Bool Display_isIdle(void);
+unsigned int Display_getWaitMicroseconds(void);
+unsigned int Display_getBytesSent(void);
+unsigned int Display_getTransfers(void);
+_Bool Display_isPanelSynced(void); // Solo con SSD1306_USE_PANEL_MODEL
 unsigned int Display_getWidth(void);
 unsigned int Display_getHeight(void);
 void Display_drawPixel(int x, int y, Color color);
 void Display_changeResolution(unsigned int x_res, unsigned int y_res);
+void Display_getResolution(unsigned int *x_res, unsigned int *y_res);
 void Display_lockResolution(void);
 void Display_unlockResolution(void);
 void Display_drawText(const char *str, int x, int y, Color color);
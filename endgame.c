@@ -0,0 +1,345 @@
+#include <stdint.h>
+#include "config.h"
+#include "endgame.h"
+#include "transposition.h"
+
+/* Symbol: Endgame
+ *   Risolutore esatto per le fasi finali della partita,
+ *   quando resta in gioco un solo serpente e restano al più
+ *   ENDGAME_MAX_FREE_CELLS celle libere. Cerca una mossa
+ *   sicura, cioè dopo la quale esiste una sequenza di mosse
+ *   che non fa perdere il serpente per sempre.
+ *
+ *   La dimostrazione si basa sul fatto che se la testa entra
+ *   in una cella del proprio corpo dopo che la coda l'ha
+ *   lasciata, da lì in poi il serpente può ripercorrere la
+ *   propria scia: le celle successive della scia si liberano
+ *   sempre prima che la testa ci arrivi (anche se il serpente
+ *   mangia mele, perché ogni mela ritarda la coda di un solo
+ *   update e può comparire solo nelle celle libere della
+ *   scia). La ricerca esplora quindi tutti i cammini
+ *   attraverso le celle che non appartengono al serpente,
+ *   finché la testa non raggiunge la propria scia.
+ *
+ *   Con degli avversari in gioco la dimostrazione non
+ *   varrebbe: un avversario può entrare nelle celle libere
+ *   del cammino o in quelle della scia prima della testa.
+ *   Per questo il risolutore non fa nulla finché c'è più di
+ *   un serpente in gioco (nelle partite a più giocatori
+ *   questo vuol dire solo quando la partita è già vinta, ma
+ *   nella modalità a un giocatore è il caso normale).
+ *
+ *   Lo stato di un nodo è determinato dalla testa, dalle
+ *   celle già attraversate (da cui dipende il numero di
+ *   mosse) e dalla mossa in cui è stata mangiata la mela,
+ *   quindi la sua chiave è lo XOR delle loro chiavi di
+ *   Zobrist.
+ *   Gli stati da cui non c'è via d'uscita sono memorizzati in
+ *   una [TranspositionTable] per non visitarli più volte; una
+ *   collisione può solo far scartare una mossa sicura, mai
+ *   farne accettare una che non lo è.
+ *
+ *   Il costo è limitato da ENDGAME_MAX_NODES nodi: se non
+ *   bastano la ricerca si arrende e nessuna mossa è
+ *   considerata dimostrata.
+ */
+
+// La testa attraversa al più le celle libere e quelle
+// degli avversari che si liberano nel frattempo.
+#define ENDGAME_MAX_DEPTH (2 * ENDGAME_MAX_FREE_CELLS)
+
+/* Symbol: EndgameFrame
+ *   Livello della ricerca di [solve]: la testa è entrata in
+ *   [pos] con direzione [dir] alla mossa [step], e
+ *   [next_dir] è la prossima direzione da provare da lì.
+ *   [idx] ed [eats] servono a ripristinare [visited] ed
+ *   [eaten_at] quando la ricerca torna indietro.
+ */
+typedef struct {
+  Position     pos;
+  Direction    dir;
+  Direction    next_dir;
+  unsigned int step;
+  uint32_t     trail_key;
+  uint32_t     key;
+  int          idx;
+  _Bool        eats;
+} EndgameFrame;
+
+typedef struct {
+  const WorldModel *world;
+  int          player;
+  int          apple_idx;
+
+  // Mossa in cui è stata mangiata la mela, oppure -1.
+  int          eaten_at;
+
+  unsigned int nodes;
+  _Bool        gave_up;
+
+  // Celle attraversate dalla ricerca (1 se la testa
+  // ci è entrata).
+  uint8_t visited[MAX_BOARD_CELLS];
+
+  // Pila esplicita di [solve], indicizzata dalla
+  // profondità: la ricerca arriva fino ad
+  // ENDGAME_MAX_DEPTH mosse, troppe per ricorrere sullo
+  // stack dei thread (1 KB, vedi AI_WORKER_STACK_SIZE).
+  EndgameFrame stack[ENDGAME_MAX_DEPTH + 1];
+} EndgameContext;
+
+// Il risolutore è chiamato sotto [Game_lock], quindi
+// basta una copia per tutti i giocatori.
+static EndgameContext     context;
+static TranspositionTable dead_states;
+static unsigned int       last_nodes;
+
+/* Symbol: isFreeAt
+ *   Ritorna 1 se la testa può entrare nella cella [idx] alla
+ *   mossa [step], e scrive in [own] se la cella è una di
+ *   quelle del serpente lasciate dalla coda.
+ *
+ *   Le celle del serpente si liberano un update più tardi
+ *   se la mela viene mangiata prima che la coda le lasci.
+ */
+static _Bool isFreeAt(EndgameContext *ctx, int idx, unsigned int step, _Bool *own)
+{
+  const WorldModel *world = ctx->world;
+
+  if (ctx->visited[idx])
+    return 0; // Fa ancora parte del corpo.
+
+  unsigned int free_in = world->free_in[idx];
+  *own = world->free_owner[idx] == ctx->player;
+  if (*own && ctx->eaten_at >= 0 && free_in > (unsigned int) ctx->eaten_at)
+    free_in++;
+  return free_in <= step;
+}
+
+static uint32_t eatenKey(int player, unsigned int step)
+{
+  return zobristKey(ZobristPiece_APPLE, player, (Position) { .x = step, .y = 0 });
+}
+
+/* Symbol: enterFrame
+ *   Inizia la visita del livello [frame]. Ritorna 0 se non
+ *   va esplorato, perché la ricerca si arrende (in tal caso
+ *   [gave_up] diventa 1) o perché lo stato è già noto come
+ *   senza via d'uscita.
+ */
+static _Bool enterFrame(EndgameContext *ctx, EndgameFrame *frame)
+{
+  if (frame->step == ENDGAME_MAX_DEPTH || ++ctx->nodes > ENDGAME_MAX_NODES) {
+    ctx->gave_up = 1;
+    return 0;
+  }
+
+  frame->key = frame->trail_key ^ zobristKey(ZobristPiece_HEAD, ctx->player, frame->pos);
+  frame->next_dir = DIR_LEFT;
+
+  int value;
+  return !TranspositionTable_probe(&dead_states, frame->key, 0, &value);
+}
+
+static void leaveFrame(EndgameContext *ctx, const EndgameFrame *frame)
+{
+  ctx->visited[frame->idx] = 0;
+  if (frame->eats)
+    ctx->eaten_at = -1;
+}
+
+typedef enum {
+  EndgameStep_CHILD,  // [child] è la prossima mossa da esplorare
+  EndgameStep_SAFE,   // La testa può raggiungere la propria scia
+  EndgameStep_DONE,   // Nessuna altra mossa da provare
+} EndgameStep;
+
+/* Symbol: nextChild
+ *   Prova le direzioni rimaste del livello [frame]. Se la
+ *   prossima porta in una cella libera la scrive in [child]
+ *   e la segna come attraversata.
+ */
+static EndgameStep nextChild(EndgameContext *ctx, EndgameFrame *frame,
+                             EndgameFrame *child)
+{
+  while (frame->next_dir <= DIR_DOWN) {
+
+    Direction next_dir = frame->next_dir++;
+    if (next_dir == oppositeDirection(frame->dir))
+      continue;
+
+    Position next = WorldModel_getNeighbour(ctx->world, frame->pos, next_dir);
+    int idx = WorldModel_cellIndex(ctx->world, next);
+
+    _Bool own;
+    if (!isFreeAt(ctx, idx, frame->step + 1, &own))
+      continue;
+    if (own)
+      return EndgameStep_SAFE;
+
+    *child = (EndgameFrame) {
+      .pos       = next,
+      .dir       = next_dir,
+      .step      = frame->step + 1,
+      .trail_key = frame->trail_key ^ zobristKey(ZobristPiece_BODY, ctx->player, next),
+      .idx       = idx,
+      .eats      = ctx->eaten_at < 0 && idx == ctx->apple_idx,
+    };
+    if (child->eats) {
+      ctx->eaten_at = child->step;
+      child->trail_key ^= eatenKey(ctx->player, child->step);
+    }
+    ctx->visited[idx] = 1;
+    return EndgameStep_CHILD;
+  }
+  return EndgameStep_DONE;
+}
+
+/* Symbol: solve
+ *   Ritorna 1 se dalla testa in [pos] con direzione [dir],
+ *   dopo [step] mosse, il serpente può raggiungere la propria
+ *   scia. [trail_key] è la chiave delle celle attraversate e
+ *   della mela mangiata.
+ *
+ *   È una visita in profondità che usa [ctx->stack] invece
+ *   della ricorsione, quindi lo stack del chiamante non
+ *   dipende da ENDGAME_MAX_DEPTH. Il livello 0 è la cella
+ *   [pos], già segnata dal chiamante.
+ */
+static _Bool solve(EndgameContext *ctx, Position pos, Direction dir,
+                   unsigned int step, uint32_t trail_key)
+{
+  EndgameFrame *stack = ctx->stack;
+  int top = 0;
+
+  stack[0] = (EndgameFrame) { .pos = pos, .dir = dir, .step = step,
+                              .trail_key = trail_key };
+  if (!enterFrame(ctx, &stack[0]))
+    return 0;
+
+  _Bool safe = 0;
+  for (;;) {
+    EndgameFrame *frame = &stack[top];
+    EndgameStep next = nextChild(ctx, frame, &stack[top + 1]);
+
+    if (next == EndgameStep_CHILD) {
+      if (enterFrame(ctx, &stack[top + 1])) {
+        top++;
+        continue;
+      }
+      leaveFrame(ctx, &stack[top + 1]);
+      if (ctx->gave_up)
+        break;
+      continue;
+    }
+
+    if (next == EndgameStep_SAFE) {
+      safe = 1;
+      break;
+    }
+
+    // Nessuna mossa porta alla scia.
+    TranspositionTable_store(&dead_states, frame->key, 0, 0);
+    if (top == 0)
+      break;
+    leaveFrame(ctx, frame);
+    top--;
+  }
+
+  // Ripristina le celle dei livelli ancora aperti.
+  for (; top > 0; --top)
+    leaveFrame(ctx, &stack[top]);
+  return safe;
+}
+
+/* Symbol: Endgame_findSafeMove
+ *   Se [player] è l'unico serpente in gioco e restano al
+ *   più ENDGAME_MAX_FREE_CELLS celle libere, cerca una mossa
+ *   sicura (vedi [Endgame]) per lui con la testa in [head].
+ *   Viene provata prima la direzione [preferred], poi le
+ *   altre direzioni di [allowed], una maschera come quella
+ *   di [WorldModel_getSafeDirections]. Il chiamante passa le
+ *   direzioni prudenti del modello, o quelle sicure se non
+ *   ce ne sono, così che il risolutore non scelga mai una
+ *   mossa che la sua euristica ha scartato. Le prime mosse
+ *   sono comunque tra quelle sicure, quindi la mossa trovata
+ *   non è mai un'inversione di marcia.
+ *
+ *   Ritorna 1 e scrive la mossa in [move] se ne ha trovata
+ *   una, 0 altrimenti (anche quando ci sono avversari in
+ *   gioco, troppe celle libere o quando la ricerca si
+ *   arrende).
+ */
+_Bool Endgame_findSafeMove(const WorldModel *world, int player, Position head,
+                           Position apple, Direction preferred,
+                           unsigned int allowed, Direction *move)
+{
+  last_nodes = 0;
+  if (WorldModel_getAlivePlayers(world) != 1
+      || WorldModel_getFreeCells(world) > ENDGAME_MAX_FREE_CELLS)
+    return 0;
+
+  EndgameContext *ctx = &context;
+  ctx->world = world;
+  ctx->player = player;
+  ctx->apple_idx = WorldModel_cellIndex(world, apple);
+  ctx->eaten_at = -1;
+  ctx->nodes = 0;
+  ctx->gave_up = 0;
+
+  const int cells = world->width * world->height;
+  for (int i = 0; i < cells; ++i)
+    ctx->visited[i] = 0;
+
+  // Le chiavi dipendono solo dalle celle attraversate
+  // a partire da questa posizione.
+  TranspositionTable_clear(&dead_states);
+
+  unsigned int first_dirs = allowed & WorldModel_getSafeDirections(world, player);
+  _Bool found = 0;
+
+  for (int i = -1; i <= DIR_DOWN && !found && !ctx->gave_up; ++i) {
+
+    Direction first = (i < 0) ? preferred : (Direction) i;
+    if (i >= 0 && first == preferred)
+      continue;
+    if (!((first_dirs >> first) & 1))
+      continue;
+
+    Position next = WorldModel_getNeighbour(world, head, first);
+    int idx = WorldModel_cellIndex(world, next);
+
+    _Bool own;
+    if (!isFreeAt(ctx, idx, 1, &own))
+      continue;
+
+    if (own)
+      found = 1;
+    else {
+      uint32_t key = zobristKey(ZobristPiece_BODY, player, next);
+      if (idx == ctx->apple_idx) {
+        ctx->eaten_at = 1;
+        key ^= eatenKey(player, 1);
+      }
+      ctx->visited[idx] = 1;
+      found = solve(ctx, next, first, 1, key);
+      ctx->visited[idx] = 0;
+      ctx->eaten_at = -1;
+    }
+
+    if (found)
+      *move = first;
+  }
+
+  last_nodes = ctx->nodes;
+  return found;
+}
+
+/* Symbol: Endgame_getLastNodes
+ *   Ritorna il numero di nodi visitati dall'ultima chiamata
+ *   ad [Endgame_findSafeMove].
+ */
+unsigned int Endgame_getLastNodes(void)
+{
+  return last_nodes;
+}
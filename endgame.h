@@ -0,0 +1,12 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "utils.h"
+#include "world.h"
+
+_Bool Endgame_findSafeMove(const WorldModel *world, int player, Position head,
+                           Position apple, Direction preferred,
+                           unsigned int allowed, Direction *move);
+unsigned int Endgame_getLastNodes(void);
+
+#endif /* ENDGAME_H */
@@ -1,3 +1,4 @@
+#include "ch.h"
 #include "game.h"
 #include "snake.h"
 #include "logger.h"
@@ -22,12 +23,32 @@ struct Game {
   _Bool started;
   
   unsigned int fps;
+
+  // Se vale 1 la partita non viene disegnata e
+  // non c' attesa tra un tick e l'altro. Serve
+  // per far giocare tra loro le IA (vedi
+  // tournament.c).
+  _Bool headless;
+
+  // Numero massimo di tick, oltre il quale la
+  // partita finisce in pareggio. 0 vuol dire
+  // nessun limite.
+  unsigned int tick_limit;
   
   // Posizione della mela.  sempre presente
   // una ed una sola mela nel gioco, e questa
   //  la sua posizione.
   Position   apple;
 
+  // Chiave di Zobrist della mela, aggiornata da
+  // [Game_spawnApple] (vedi [Game_getHash]).
+  uint32_t   apple_hash;
+
+  // Generatore usato per la mela e per le posizioni
+  // iniziali dei serpenti, separato da quello di
+  // default con [Rng_split].
+  Rng rng;
+
   // Numero di giocatori aggiunti usando
   // [Game_plugJoystick]. Una volta che la
   // partita  cominciata usango [Game_play],
@@ -40,6 +61,19 @@ struct Game {
   _Bool          lost[MAX_PLAYERS_PER_GAME];
   Snake       *snakes[MAX_PLAYERS_PER_GAME];
   Joystick *joysticks[MAX_PLAYERS_PER_GAME];
+  unsigned int  apples[MAX_PLAYERS_PER_GAME];    // Mele mangiate
+  unsigned int lost_at[MAX_PLAYERS_PER_GAME];    // Tick della morte
+
+  // Protegge lo stato della partita dai thread
+  // dei giocatori artificiali asincroni (vedi
+  // [AIJoystick_initAsync]), che lo leggono
+  // mentre [Game_play]  in attesa del tick
+  // successivo.
+  mutex_t lock;
+
+  // Modello del mondo condiviso dai giocatori
+  // artificiali (vedi [Game_getWorldModel]).
+  WorldModel world;
 };
 
 /* Symbol: Game_plugJoystick
@@ -72,6 +106,8 @@ _Bool Game_plugJoystick(Game *game, Joystick *joystick)
                        // da quanti serpenti ci sono in 
                        // tutto (per metterli equidistanti).
   game->joysticks[i] = joystick;
+  game->apples[i] = 0;
+  game->lost_at[i] = 0;
   game->player_count++;
   return 1;
 }
@@ -95,26 +131,85 @@ static _Bool isSnakeAt(Game *game, Position pos)
  *   per questa funzione sarebbe potuto essere [Game_respawnApple].
  *
  * Nota: La posizione della mela  generata usando il generatore
- *       di numeri pseudo-casuali di default (in utils.c). Se la 
+ *       di numeri pseudo-casuali della partita (vedi [Rng]). Se la 
  *       posizione generata  occupata (da un serpente), allora
- *       ne sar generata una nuova. Se il generatore di numeri
- *       casuali genera una sequenza circolare di numeri che sono
- *       relativi a posizioni tutte occupate, questa funzione
- *       non riuscir mai a trovare una posizione e concludersi.
+ *       ne sar generata una nuova. Dopo APPLE_RANDOM_ATTEMPTS
+ *       tentativi falliti (succede quando la griglia  quasi
+ *       piena, oppure se il generatore non riesce a produrre
+ *       le posizioni libere) la mela viene messa nella prima
+ *       cella libera che segue l'ultima posizione generata.
+ *       La griglia deve avere almeno una cella libera.
  */
+#define APPLE_RANDOM_ATTEMPTS 16
+
 static void Game_spawnApple(Game *game)
 {
   Position pos;
-  int attempt = 0; // Teniamo traccia del numero di tentativi
-                   // per debuggare eventuali cicli infiniti.
+  int attempt = 0;
   do {
     Logger_printf("(Game tick %d) Placing apple (attempt %d)", game->ticks, attempt);
-    pos = newRandomPosition();
+    pos = Rng_position(&game->rng);
     Logger_printf("(Game tick %d) Generated apple position (%d, %d)", game->ticks, pos.x, pos.y);
     attempt++;
-  } while (isSnakeAt(game, pos));
+  } while (isSnakeAt(game, pos) && attempt < APPLE_RANDOM_ATTEMPTS);
+
+  while (isSnakeAt(game, pos))
+    pos = (pos.x+1 < (int) Display_getWidth())
+        ? newPosition(pos.x+1, pos.y)
+        : newPosition(0, pos.y+1);
 
   game->apple = pos;
+  game->apple_hash = zobristKey(ZobristPiece_APPLE, 0, pos);
+}
+
+/* Symbol: Game_lock, Game_unlock
+ *   Acquisiscono e rilasciano l'accesso esclusivo allo
+ *   stato della partita. [Game_play] tiene il lock mentre
+ *   legge l'input e aggiorna i serpenti, quindi chi legge
+ *   lo stato tra una [Game_lock] e una [Game_unlock] vede
+ *   sempre l'ultimo tick pubblicato per intero.
+ *
+ * Nota: Il lock non  ricorsivo. I metodi "Game_get*"
+ *       non lo acquisiscono,  compito del chiamante
+ *       farlo se non si trova nel thread di [Game_play].
+ */
+void Game_lock(Game *game)
+{
+  chMtxLock(&game->lock);
+}
+
+void Game_unlock(Game *game)
+{
+  chMtxUnlock(&game->lock);
+}
+
+unsigned int Game_getTicks(Game *game)
+{
+  return game->ticks;
+}
+
+void Game_setHeadless(Game *game, _Bool headless)
+{
+  game->headless = headless;
+}
+
+void Game_setTickLimit(Game *game, unsigned int tick_limit)
+{
+  game->tick_limit = tick_limit;
+}
+
+unsigned int Game_getPlayerApples(Game *game, int player)
+{
+  return game->apples[player];
+}
+
+/* Symbol: Game_getPlayerSurvivalTicks
+ *   Ritorna il numero di tick per cui il giocatore
+ *   [player]  rimasto in vita.
+ */
+unsigned int Game_getPlayerSurvivalTicks(Game *game, int player)
+{
+  return game->lost[player] ? game->lost_at[player] : game->ticks;
 }
 
 Position Game_getApplePosition(Game *game)
@@ -127,53 +222,78 @@ Position Game_getPlayerHeadPosition(Game *game, int player)
   return Snake_getHeadPosition(game->snakes[player]);
 }
 
+Position Game_getPlayerTailPosition(Game *game, int player)
+{
+  return Snake_getTailPosition(game->snakes[player]);
+}
+
+Direction Game_getPlayerDirection(Game *game, int player)
+{
+  return Snake_getDirection(game->snakes[player]);
+}
+
+unsigned int Game_getPlayerSize(Game *game, int player)
+{
+  return Snake_getSize(game->snakes[player]);
+}
+
+/* Symbol: Game_getWorldModel
+ *   Ritorna il modello del mondo relativo al tick corrente.
+ *   Il modello  costruito la prima volta che viene chiesto
+ *   durante un tick e poi riutilizzato da tutti i giocatori
+ *   fino al prossimo update, quindi il suo costo non dipende
+ *   dal numero di giocatori artificiali.
+ *
+ * Nota: Il modello appartiene alla partita e non deve
+ *       essere modificato. I giocatori asincroni devono
+ *       chiamare questa funzione tenendo il lock della
+ *       partita (vedi [Game_lock]).
+ */
+const WorldModel *Game_getWorldModel(Game *game)
+{
+  WorldModel *world = &game->world;
+  if (!world->valid || world->ticks != game->ticks)
+    WorldModel_build(world, game->ticks, game->snakes, game->lost,
+                     game->player_count, game->apple);
+  return world;
+}
+
+/* Symbol: Game_getHash
+ *   Ritorna l'hash di Zobrist dello stato della partita:
+ *   lo XOR degli hash dei serpenti ancora in gioco (vedi
+ *   [Snake_getHash]) e della chiave della mela. Gli hash
+ *   sono aggiornati in O(1) ad ogni passo e ad ogni nuova
+ *   mela, quindi il costo dipende solo dal numero di
+ *   giocatori.
+ *
+ *   Due partite giocate con lo stesso seme e gli stessi
+ *   comandi hanno lo stesso hash ad ogni tick, quindi
+ *   confrontando gli hash tick per tick si trova il primo
+ *   tick in cui un replay diverge dall'originale.
+ */
+uint32_t Game_getHash(Game *game)
+{
+  uint32_t hash = game->apple_hash;
+  for (int i = 0; i < game->player_count; ++i)
+    if (!game->lost[i] && game->snakes[i] != 0)
+      hash ^= Snake_getHash(game->snakes[i]);
+  return hash;
+}
+
 /* Symbol: Game_wouldLoseNextUpdateIf
  *   Ritorna 1 se il giocatore [player] perderebbe cambiando
  *   la direzione del serpente a [dir] nel prossimo update
  *   del gioco, 0 altrimenti.
+ *
+ *   Il giocatore perde se la sua testa futura finisce su
+ *   una cella che sar ancora occupata da un serpente,
+ *   oppure sulla testa futura di un avversario (assumendo
+ *   che gli avversari non cambino direzione).
  */
 _Bool Game_wouldLoseNextUpdateIf(Game *game, int player, Direction dir)
 {
-  Snake   *player_snake = game->snakes[player];
-  Position player_head = Snake_getHeadPosition(player_snake);
-
-  // La posizione della testa del giocatore se 
-  // al prossimo update andasse nella direzione 
-  // specificata.
-  Position future_player_head = evaluateNextPosition(player_head, dir);
-
-  // Itera lungo ciascun serpente, valuta la 
-  // sua posizione futura (assumendo che non
-  // cambi direzione) e controlla che la testa
-  // futura del giocatore non ci sbatti contro.
-  for (int i = 0; i < game->player_count; ++i) {
-
-    Snake    *opponent_snake = game->snakes[i];
-    Position  opponent_head  = Snake_getHeadPosition(opponent_snake);
-    Direction opponent_dir   = Snake_getDirection(opponent_snake);
-    Position future_opponent_head = evaluateNextPosition(opponent_head, opponent_dir);
-
-    // Controlla se il giocatore si scontrerebbe contro
-    // il serpente del giocatore [i].
-
-    // Si scontrerebbero se la posizione futura testa del
-    // giocatore combaciasse con la futura testa del nemico
-    // oppure con una delle attuali posizioni del corpo
-    // nemico meno l'ultimo blocco.
-    if (player_snake != opponent_snake &&
-        future_player_head.x == future_opponent_head.x &&
-        future_player_head.y == future_opponent_head.y)
-      return 1;
-
-    SnakeIter iter = SnakeIter_new(opponent_snake);
-    for (int j = 0; j < (int) Snake_getSize(opponent_snake)-1; ++j) {
-      if (iter.pos.x == future_player_head.x &&
-          iter.pos.y == future_player_head.y)
-        return 1; // Si scontrerebbe col corpo!!
-      SnakeIter_next(&iter);
-    }
-  }
-  return 0;
+  const WorldModel *world = Game_getWorldModel(game);
+  return !(WorldModel_getSafeDirections(world, player) & (1 << dir));
 }
 
 /* Symbol: Game_calculateAlivePlayers
@@ -230,10 +350,14 @@ static GameEvent Game_update(Game *game)
 
       // Il serpente ha mangiato la mela!
 
-      if (Snake_getSize(snake) == max_snake_size)
+      // Dopo essere cresciuto il serpente occuperebbe
+      // tutta la griglia, quindi non ci sarebbe posto
+      // per una nuova mela.
+      if (Snake_getSize(snake) + 1 >= max_snake_size)
         return (GameEvent) { GameEventType_WIN, i };
 
       Snake_grow(snake);
+      game->apples[i]++;
       Game_spawnApple(game); // Sovrascrive la mela che c' gi.
     }
 
@@ -251,6 +375,7 @@ static GameEvent Game_update(Game *game)
 
     if (died) {
       game->lost[i] = 1;
+      game->lost_at[i] = game->ticks;
 
       int alive = Game_calculateAlivePlayers(game);
       Logger_printf("(Game tick %d) A snake died, "
@@ -311,6 +436,11 @@ static _Bool Game_init(Game *game, unsigned int fps)
   game->started = 0;
   game->player_count = 0;
   game->fps = fps;
+  game->headless = 0;
+  game->tick_limit = 0;
+  chMtxObjectInit(&game->lock);
+  WorldModel_invalidate(&game->world);
+  Rng_split(getDefaultRng(), &game->rng);
   Game_spawnApple(game); // Must be called after adding the snake.
   return 1;
 }
@@ -373,10 +503,18 @@ GameEvent Game_play(Game *game)
 
   Display_lockResolution();
 
+  if (Display_getWidth() * Display_getHeight() > MAX_BOARD_CELLS) {
+    // Il modello del mondo non pu rappresentare
+    // una griglia cos grande.
+    Logger_printf("ERROR :: The board has more than %d cells", MAX_BOARD_CELLS);
+    Display_unlockResolution();
+    return (GameEvent) { GameEventType_ERROR, -1 };
+  }
+
   // Aggiungi un serpente per ciascun giocatore.
   for (int i = 0; i < game->player_count; ++i) {
 
-    Snake *snake = Snake_new2();
+    Snake *snake = Snake_new2(&game->rng);
 
     if (snake == 0) {
 
@@ -394,6 +532,7 @@ GameEvent Game_play(Game *game)
       return (GameEvent) { GameEventType_ERROR, -1 };
     }
 
+    Snake_setOwner(snake, i);
     game->snakes[i] = snake;
   }
 
@@ -401,6 +540,8 @@ GameEvent Game_play(Game *game)
 
   while (1) {
 
+    Game_lock(game);
+
     // Gestisci l'input di ciascun giocatore.
     for (int i = 0; i < game->player_count; ++i) {
 
@@ -417,13 +558,22 @@ GameEvent Game_play(Game *game)
     }
 
     GameEvent event = Game_update(game);
+    Game_unlock(game);
+
     if (event.type != GameEventType_NOEVENT) {
       Display_unlockResolution();
       return event;
     }
 
-    Game_draw(game);
-    delay(1000 / game->fps);
+    if (game->tick_limit > 0 && game->ticks >= game->tick_limit) {
+      Display_unlockResolution();
+      return (GameEvent) { GameEventType_DRAW, -1 };
+    }
+
+    if (!game->headless) {
+      Game_draw(game);
+      delay(1000 / game->fps);
+    }
   }
   /* UNREACHABLE */
   Display_unlockResolution();
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "world.h"
 #include "joystick.h"
 
 typedef enum {
@@ -24,6 +25,11 @@ typedef enum {
   // valore.
   GameEventType_LOSE,
 
+  // La partita ha raggiunto il limite di tick
+  // impostato con [Game_setTickLimit] senza che
+  // nessuno vincesse.
+  GameEventType_DRAW,
+
 } GameEventType;
 
 /* Symbol: GameEvent
@@ -63,9 +69,27 @@ Game     *Game_new(unsigned int fps);
 GameEvent Game_play(Game *game);
 void      Game_free(Game *game);
 _Bool     Game_plugJoystick(Game *game, Joystick *joystick);
+void      Game_setHeadless(Game *game, _Bool headless);
+void      Game_setTickLimit(Game *game, unsigned int tick_limit);
 
 // Questi sono metodi che espongono lo stato del 
 // gioco necessario all'intelligenza artificiale.
 Position Game_getApplePosition(Game *game);
 Position Game_getPlayerHeadPosition(Game *game, int player);
+Position Game_getPlayerTailPosition(Game *game, int player);
+Direction    Game_getPlayerDirection(Game *game, int player);
+unsigned int Game_getPlayerSize(Game *game, int player);
 _Bool    Game_wouldLoseNextUpdateIf(Game *game, int player, Direction dir);
+const WorldModel *Game_getWorldModel(Game *game);
+
+// Sincronizzazione con i giocatori che leggono lo
+// stato da un altro thread (vedi [Game_lock]).
+void         Game_lock(Game *game);
+void         Game_unlock(Game *game);
+unsigned int Game_getTicks(Game *game);
+uint32_t     Game_getHash(Game *game);
+
+// Statistiche dei giocatori, valide anche dopo la
+// fine della partita (fino a [Game_free]).
+unsigned int Game_getPlayerApples(Game *game, int player);
+unsigned int Game_getPlayerSurvivalTicks(Game *game, int player);
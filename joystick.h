@@ -2,6 +2,9 @@
 #ifndef JOYSTICK_H_
 #define JOYSTICK_H_
 
+#include "utils.h"
+#include "config.h"
+
 typedef enum {
   BUTTON_UP,
   BUTTON_DOWN,
@@ -27,8 +30,11 @@ typedef struct {
  *   Al momento, un joystick può essere un oggetto
  *   che rappresenta un joystick fisico (PhysicalJoystick
  *   implementato in "console.c") oppure un joystick
- *   simulato virtualmente (RandomJoystick e AIJoystick
- *   rispettivamente da joystick_random.c e joystick_ai.c).
+ *   simulato virtualmente (RandomJoystick, AIJoystick,
+ *   HamiltonJoystick, PathJoystick, PolicyJoystick e
+ *   SearchJoystick rispettivamente da joystick_random.c,
+ *   joystick_ai.c, joystick_hamilton.c, joystick_path.c,
+ *   joystick_policy.c e joystick_search.c).
  */
 struct Joystick {
   JoystickMethodTable *table;
@@ -36,17 +42,103 @@ struct Joystick {
 
 typedef struct {
   Joystick base;
-  int seed;
+  Rng      rng;
+
+  // Numeri casuali in [0, 12) generati a blocchi
+  // (vedi [nextRandom] in joystick_random.c) ed
+  // indice del prossimo da usare.
+  uint16_t     batch[RANDOM_JOYSTICK_BATCH];
+  unsigned int batch_next;
+
+  // Se diverso da NULL, il joystick sceglie solo
+  // tra le direzioni che non fanno perdere nella
+  // partita [game] (vedi [RandomJoystick_initSafe]).
+  void *game;
 } RandomJoystick;
 
+typedef struct AIWorker AIWorker;
+
+typedef struct {
+  Joystick  base;
+  void     *game;
+
+  // Thread che calcola le decisioni, solo per
+  // i joystick creati con [AIJoystick_initAsync].
+  // Per quelli sincroni è NULL.
+  AIWorker *worker;
+
+  // Ultima decisione ricevuta dal thread e numero
+  // di tick in cui la decisione non era pronta in
+  // tempo.
+  Button       last_button;
+  unsigned int missed_deadlines;
+} AIJoystick;
+
 typedef struct {
   Joystick base;
   void    *game;
-} AIJoystick;
+} HamiltonJoystick;
+
+typedef struct PathPlan PathPlan;
+
+typedef struct {
+  Joystick  base;
+  void     *game;
+  PathPlan *plan;
+
+  // Numero di volte in cui il percorso è stato
+  // ricalcolato da zero e riparato localmente.
+  unsigned int replans;
+  unsigned int repairs;
+} PathJoystick;
+
+typedef struct {
+  Joystick base;
+  void    *game;
+} PolicyJoystick;
+
+struct TranspositionTable;
+struct AIBudget;
+
+typedef struct {
+  Joystick base;
+  void    *game;
+
+  // Tabella delle trasposizioni usata dalla ricerca,
+  // che può essere condivisa da più joystick.
+  struct TranspositionTable *table;
+
+  // Budget di tempo e indice del giocatore nel budget
+  // (vedi [SearchJoystick_setBudget]). Senza budget la
+  // ricerca arriva sempre a AI_SEARCH_DEPTH mosse.
+  struct AIBudget *budget;
+  int              budget_bot;
+
+  // Somma delle profondità raggiunte e numero di
+  // decisioni prese.
+  unsigned int depth_sum;
+  unsigned int decisions;
+} SearchJoystick;
 
 void  AIJoystick_init(AIJoystick *ai, void *game);
+_Bool AIJoystick_initAsync(AIJoystick *ai, void *game);
+unsigned int AIJoystick_getMissedDeadlines(AIJoystick *ai);
+void  HamiltonJoystick_init(HamiltonJoystick *ai, void *game);
+_Bool PathJoystick_init(PathJoystick *ai, void *game);
+unsigned int PathJoystick_getReplans(PathJoystick *ai);
+unsigned int PathJoystick_getRepairs(PathJoystick *ai);
+void  PolicyJoystick_init(PolicyJoystick *ai, void *game);
+void  SearchJoystick_init(SearchJoystick *ai, void *game, struct TranspositionTable *transpositions);
+_Bool SearchJoystick_setBudget(SearchJoystick *ai, struct AIBudget *budget);
+unsigned int SearchJoystick_getDecisions(SearchJoystick *ai);
+unsigned int SearchJoystick_getDepthSum(SearchJoystick *ai);
+unsigned int SearchJoystick_getOverruns(SearchJoystick *ai);
+#if AI_SEARCH_WORKERS > 1
+unsigned int SearchJoystick_setWorkers(unsigned int workers);
+#endif
 void  RandomJoystick_init(RandomJoystick *joystick);
 void  RandomJoystick_init2(RandomJoystick *joystick, int seed);
+void  RandomJoystick_initSafe(RandomJoystick *joystick, void *game, int seed);
 
 Button Joystick_getButton(Joystick *joystick, int player);
 void   Joystick_free(Joystick *joystick);
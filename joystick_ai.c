@@ -1,102 +1,109 @@
+#include "ch.h"
 #include "game.h"
+#include "config.h"
 #include "logger.h"
 #include "display.h"
 #include "joystick.h"
+#include "endgame.h"
+
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
 
 /* Symbol: evaluateBestDirection
  *   Data una partita avviata [game] ed un giocatore
  *   [player], questa funzione valuta la "migliore"
  *   scelta a disposizione del giocatore [player].
  *
- *   La scelta non è ottima ma basata su un algoritmo
- *   che ha un buon compromesso tra prestazioni e
- *   utilizzo di risorse.
- * 
+ *   Tra le direzioni che non portano a perdere al
+ *   prossimo update (esclusa l'inversione di marcia, che
+ *   [Snake_changeDirection] ignora) viene scelta quella
+ *   che porta più vicino alla mela secondo il campo di
+ *   distanze del modello del mondo. Se la mela non è
+ *   raggiungibile viene scelta la prima direzione
+ *   sicura.
+ *
+ *   Le direzioni che lasciano al serpente meno celle della
+ *   sua lunghezza (vedi [WorldModel_getMoveTerritory]) sono
+ *   scelte solo se non ce ne sono altre, ed in tal caso si
+ *   sceglie quella con più celle: così il serpente non si
+ *   chiude in una sacca e si tiene lontano dalle zone che
+ *   gli avversari raggiungerebbero prima di lui.
+ *
+ *   Se possibile si evitano anche le celle in cui un
+ *   avversario potrebbe entrare cambiando direzione (vedi
+ *   [WorldModel_getCautiousDirections]).
+ *
+ *   Quando il serpente è rimasto solo e restano poche celle
+ *   libere la scelta è verificata con [Endgame_findSafeMove],
+ *   che la sostituisce con una mossa sicura (vedi [Endgame])
+ *   se la trova, tra le stesse direzioni prudenti.
+ *
+ *   Il modello del mondo è condiviso con gli altri
+ *   giocatori artificiali e calcolato una volta per
+ *   tick, quindi questa funzione costa O(1).
  */
 static Button evaluateBestDirection(Game *game, int player)
 {
-  Position apple = Game_getApplePosition(game);
-  Position snake = Game_getPlayerHeadPosition(game, player);
-
-  int would_lose_going_up = -1;
-  int would_lose_going_down = -1;
-  int would_lose_going_left = -1;
-  int would_lose_going_right = -1;
-
-  if (apple.x != snake.x) {
-    // Valuta la distanza dalla mela andando
-    // verso sinistra e verso destra.
-    int distance_going_left;
-    int distance_going_right;
-    if (apple.x < snake.x) {
-      distance_going_left  = snake.x - apple.x;
-      distance_going_right = Display_getWidth() + apple.x - snake.x;
-    } else {
-      distance_going_left  = Display_getWidth() + snake.x - apple.x;
-      distance_going_right = apple.x - snake.x;
-    }
+  const WorldModel *world = Game_getWorldModel(game);
+  Position head = Game_getPlayerHeadPosition(game, player);
 
-    // Scegli la direzione con la distanza
-    // minore. Se però questa porterebbe a
-    // perdere, scegli quella opposta.
-    // Se anche la seconda scelta porterebbe
-    // a perdere, delega la decisione al 
-    // resto della funzione.
+  unsigned int size = Game_getPlayerSize(game, player);
+  unsigned int cautious = WorldModel_getCautiousDirections(world, player);
+  Direction backwards = oppositeDirection(Game_getPlayerDirection(game, player));
 
-    would_lose_going_left = Game_wouldLoseNextUpdateIf(game, player, DIR_LEFT);
-    if (distance_going_left < distance_going_right && !would_lose_going_left)
-      return BUTTON_LEFT;
+  Direction best_dir = DIR_DOWN;
+  Button best_button = BUTTON_NULL;
+  unsigned int best_distance = 0;
+  unsigned int best_territory = 0;
+  _Bool best_roomy = 0;
 
-    would_lose_going_right = Game_wouldLoseNextUpdateIf(game, player, DIR_RIGHT);
-    if (!would_lose_going_right)
-      return BUTTON_RIGHT;
-  }
+  for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
 
-  if (apple.y != snake.y) {
-    // Valuta la distanza dalla mela andando 
-    // verso l'alto o verso il basso.
-    int distance_going_up;
-    int distance_going_down;
-    if (apple.y < snake.y) {
-      distance_going_up  = snake.y - apple.y;
-      distance_going_down = Display_getHeight() + apple.y - snake.y;
-    } else {
-      distance_going_up = Display_getHeight() + snake.y - apple.y;
-      distance_going_down = apple.y - snake.y;
-    }
+    // Il serpente non può invertire la marcia.
+    if (dir == backwards)
+      continue;
+    if (Game_wouldLoseNextUpdateIf(game, player, dir))
+      continue;
+    if (cautious != 0 && !((cautious >> dir) & 1))
+      continue;
 
-    // Scegli la direzione pià veloce se non
-    // porta a perdere, altrimenti scegli
-    // quella opposta. Se anche quella opposta
-    // porterebbe a perdere, non decidere ancora.
+    unsigned int distance = WorldModel_getAppleDistance(world, evaluateNextPosition(head, dir));
+    unsigned int territory = WorldModel_getMoveTerritory(world, player, dir);
+    _Bool roomy = territory >= size;
 
-    would_lose_going_up = Game_wouldLoseNextUpdateIf(game, player, DIR_UP);
-    if (distance_going_up < distance_going_down && !would_lose_going_up)
-      return BUTTON_UP;
+    _Bool better;
+    if (best_button == BUTTON_NULL || roomy != best_roomy)
+      better = best_button == BUTTON_NULL || roomy;
+    else if (roomy)
+      better = distance < best_distance;
+    else
+      better = territory > best_territory;
 
-    would_lose_going_down = Game_wouldLoseNextUpdateIf(game, player, DIR_DOWN);
-    if (!would_lose_going_down)
-      return BUTTON_DOWN;
+    if (better) {
+      best_dir = dir;
+      best_button = direction_buttons[dir];
+      best_distance = distance;
+      best_territory = territory;
+      best_roomy = roomy;
+    }
   }
 
-  // Scegli una posizione che non porta a perdere.
-  // Se una posizione del genere non esiste, scegli
-  // di andare verso il basso.
-
-  if (would_lose_going_left == -1 && !Game_wouldLoseNextUpdateIf(game, player, DIR_LEFT))
-      return BUTTON_LEFT;
-
-  if (would_lose_going_right == -1 && !Game_wouldLoseNextUpdateIf(game, player, DIR_RIGHT))
-      return BUTTON_RIGHT;
-
-  if (would_lose_going_up == -1 && !Game_wouldLoseNextUpdateIf(game, player, DIR_UP))
-      return BUTTON_UP;
-#ifndef NOLOGGING
-  if (Game_wouldLoseNextUpdateIf(game, player, DIR_DOWN)) {
-    Logger_printf("AI Player %d is trapped!\n", player);
+  if (best_button == BUTTON_NULL) {
+    // Tutte le direzioni portano a perdere.
+    Logger_printf("AI Player %d is trapped!", player);
+    return BUTTON_DOWN;
   }
-#endif
-  return BUTTON_DOWN;
+
+  Direction safe_dir;
+  if (Endgame_findSafeMove(world, player, head, Game_getApplePosition(game), best_dir,
+                           cautious ? cautious : WorldModel_getSafeDirections(world, player),
+                           &safe_dir))
+    return direction_buttons[safe_dir];
+  return best_button;
 }
 
 static Button getButton(Joystick *joystick, int player)
@@ -118,4 +125,222 @@ void AIJoystick_init(AIJoystick *ai, void *game)
 {
   ai->base.table = &table;
   ai->game = game;
+  ai->worker = 0;
+  ai->last_button = BUTTON_NULL;
+  ai->missed_deadlines = 0;
+}
+
+/* Symbol: AIWorker
+ *   Thread che calcola le decisioni di un [AIJoystick]
+ *   asincrono. Il thread dorme finché [getButtonAsync]
+ *   non gli chiede una nuova decisione, poi la calcola
+ *   sull'ultimo stato pubblicato da [Game_play] (cioè
+ *   tenendo il lock della partita) e la consegna nella
+ *   mailbox [decisions].
+ *
+ *   Ogni messaggio della mailbox contiene sia il bottone
+ *   scelto che il tick della partita sul quale è stato
+ *   calcolato, così da poter riconoscere le decisioni
+ *   arrivate in ritardo.
+ */
+struct AIWorker {
+  THD_WORKING_AREA(wa, AI_WORKER_STACK_SIZE);
+  thread_t *thread;
+  Game     *game;
+  int       player;
+
+  // Diventa 0 quando il joystick viene distrutto
+  // per far terminare il thread.
+  volatile _Bool running;
+
+  // Vale 1 se è già stata chiesta almeno una
+  // decisione al thread. Serve a non contare
+  // come ritardo il primo tick della partita.
+  _Bool requested;
+
+  binary_semaphore_t request;
+  mailbox_t decisions;
+  msg_t     decisions_buffer[2];
+};
+
+/* Symbol: worker_pool, worker_free_list, worker_pool_usage
+ *   Allocatore dei thread dei giocatori artificiali. Funziona
+ *   come quello dei serpenti in snake.c, quindi non è possibile
+ *   avere più di MAX_AI_WORKERS giocatori asincroni insieme.
+ */
+typedef union AIWorkerSlot AIWorkerSlot;
+union AIWorkerSlot {
+  AIWorker worker;
+  AIWorkerSlot *next;
+};
+
+static AIWorkerSlot worker_pool[MAX_AI_WORKERS];
+static AIWorkerSlot *worker_free_list = 0;
+static unsigned int worker_pool_usage = 0;
+
+static AIWorker *AIWorker_alloc(void)
+{
+  if (worker_free_list == 0) {
+    if (worker_pool_usage == 0) {
+      // È necessario costruire la freelist.
+      for (int i = 0; i < MAX_AI_WORKERS-1; ++i)
+        worker_pool[i].next = worker_pool + i + 1;
+      worker_pool[MAX_AI_WORKERS-1].next = 0;
+      worker_free_list = worker_pool;
+    } else {
+      Logger_printf("ERROR :: Couldn't allocate AI worker");
+      return 0;
+    }
+  }
+
+  AIWorker *worker = &worker_free_list->worker;
+  worker_free_list = worker_free_list->next;
+  worker_pool_usage++;
+  return worker;
+}
+
+static void AIWorker_free(AIWorker *worker)
+{
+  AIWorkerSlot *slot = (AIWorkerSlot*) worker;
+  slot->next = worker_free_list;
+  worker_free_list = slot;
+  worker_pool_usage--;
+}
+
+#define DECISION_TICKS_MASK 0xFFFFFF
+
+static msg_t encodeDecision(unsigned int ticks, Button button)
+{
+  return (msg_t) (((ticks & DECISION_TICKS_MASK) << 3) | button);
+}
+
+static Button decodeDecisionButton(msg_t msg)
+{
+  return (Button) (msg & 7);
+}
+
+static unsigned int decodeDecisionTicks(msg_t msg)
+{
+  return ((unsigned int) msg >> 3) & DECISION_TICKS_MASK;
+}
+
+static THD_FUNCTION(workerLoop, arg)
+{
+  AIWorker *worker = (AIWorker*) arg;
+
+  chRegSetThreadName("AIWorker");
+
+  while (1) {
+
+    chBSemWait(&worker->request);
+    if (!worker->running)
+      break;
+
+    Game *game = worker->game;
+
+    Game_lock(game);
+    Button button = evaluateBestDirection(game, worker->player);
+    unsigned int ticks = Game_getTicks(game);
+    Game_unlock(game);
+
+    // La mailbox non può essere piena perché ad ogni
+    // richiesta corrisponde al più una decisione, ma
+    // per sicurezza non aspettiamo mai.
+    (void) chMBPostTimeout(&worker->decisions,
+                           encodeDecision(ticks, button),
+                           TIME_IMMEDIATE);
+  }
+  chThdExit(0);
+}
+
+/* Symbol: getButtonAsync
+ *   Versione di [getButton] per i joystick asincroni. Non
+ *   blocca mai: preleva dalla mailbox le decisioni arrivate
+ *   dall'ultima chiamata (tenendo l'ultima), poi chiede al
+ *   thread di calcolare quella del prossimo tick.
+ *
+ *   Se per il tick corrente non è arrivata alcuna decisione
+ *   calcolata sullo stato attuale, la scadenza è considerata
+ *   mancata e viene ritornata l'ultima decisione disponibile.
+ */
+static Button getButtonAsync(Joystick *joystick, int player)
+{
+  AIJoystick *ai = (AIJoystick*) joystick;
+  AIWorker *worker = ai->worker;
+  Game *game = (Game*) ai->game;
+
+  _Bool fresh = 0;
+  msg_t msg;
+  while (chMBFetchTimeout(&worker->decisions, &msg, TIME_IMMEDIATE) == MSG_OK) {
+    ai->last_button = decodeDecisionButton(msg);
+    fresh = decodeDecisionTicks(msg) == (Game_getTicks(game) & DECISION_TICKS_MASK);
+  }
+
+  if (worker->requested && !fresh) {
+    ai->missed_deadlines++;
+    Logger_printf("AI player %d missed the deadline of tick %d",
+                  player, Game_getTicks(game));
+  }
+
+  worker->player = player;
+  worker->requested = 1;
+  chBSemSignal(&worker->request);
+
+  return ai->last_button;
+}
+
+static void freeAsync(Joystick *joystick)
+{
+  AIJoystick *ai = (AIJoystick*) joystick;
+  AIWorker *worker = ai->worker;
+
+  worker->running = 0;
+  chBSemSignal(&worker->request);
+  chThdWait(worker->thread);
+
+  AIWorker_free(worker);
+  ai->worker = 0;
+}
+
+static JoystickMethodTable async_table = {
+  .getButton = getButtonAsync,
+  .free = freeAsync,
+};
+
+/* Symbol: AIJoystick_initAsync
+ *   Come [AIJoystick_init], ma le decisioni sono calcolate
+ *   da un thread a priorità AI_WORKER_PRIO (minore di quella
+ *   del gioco), così che un'IA lenta non ritardi il tick
+ *   degli altri giocatori. Il joystick va distrutto con
+ *   [Joystick_free] prima di [Game_free].
+ *
+ *   Se non ci sono thread disponibili, il joystick viene
+ *   inizializzato come sincrono e viene ritornato 0.
+ */
+_Bool AIJoystick_initAsync(AIJoystick *ai, void *game)
+{
+  AIJoystick_init(ai, game);
+
+  AIWorker *worker = AIWorker_alloc();
+  if (worker == 0)
+    return 0;
+
+  worker->game = (Game*) game;
+  worker->player = 0;
+  worker->running = 1;
+  worker->requested = 0;
+  chBSemObjectInit(&worker->request, 1);
+  chMBObjectInit(&worker->decisions, worker->decisions_buffer,
+                 sizeof(worker->decisions_buffer) / sizeof(msg_t));
+  worker->thread = chThdCreateStatic(worker->wa, sizeof(worker->wa),
+                                     AI_WORKER_PRIO, workerLoop, worker);
+
+  ai->base.table = &async_table;
+  ai->worker = worker;
+  return 1;
+}
+
+unsigned int AIJoystick_getMissedDeadlines(AIJoystick *ai)
+{
+  return ai->missed_deadlines;
 }
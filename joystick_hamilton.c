@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include "game.h"
+#include "config.h"
+#include "logger.h"
+#include "display.h"
+#include "joystick.h"
+
+/* Symbol: HamiltonJoystick
+ *   Giocatore artificiale per le partite con un solo
+ *   giocatore (modalità CLASSIC). Il serpente segue un
+ *   ciclo hamiltoniano precalcolato, cioè un percorso
+ *   chiuso che passa una ed una sola volta per ogni cella
+ *   della griglia. Seguendo il ciclo il serpente non può
+ *   mai mordersi, quindi è garantito che riempia tutta la
+ *   griglia.
+ *
+ *   Per non impiegare N tick per ogni mela, il serpente
+ *   può prendere delle scorciatoie: in ordine di ciclo, le
+ *   celle comprese tra la testa e la coda sono sempre
+ *   libere, quindi saltare in avanti di [d] posizioni è
+ *   sicuro finché non si supera la coda (con un margine
+ *   per la crescita) e non si salta la mela.
+ *
+ *   Ogni decisione costa O(1): qualche lettura delle
+ *   tabelle del ciclo per le quattro celle adiacenti.
+ *
+ * Nota: L'invariante sulle celle libere vale solo se
+ *       il serpente è l'unico in gioco.
+ */
+
+// Margine (in celle di ciclo) lasciato tra la testa e
+// la coda dopo una scorciatoia.
+#define SHORTCUT_MARGIN 4
+
+/* Symbol: cycle_next, cycle_order
+ *   Tabelle del ciclo. [cycle_next] contiene per ogni cella
+ *   la direzione da prendere per seguire il ciclo, codificata
+ *   su 2 bit (quattro celle per byte). [cycle_order] è la
+ *   posizione della cella lungo il ciclo a partire dalla
+ *   cella (0, 0).
+ *
+ *   Le tabelle dipendono solo dalle dimensioni della griglia,
+ *   quindi sono condivise da tutti i joystick e ricostruite
+ *   solo quando la risoluzione cambia.
+ */
+static uint8_t  cycle_next[(MAX_BOARD_CELLS + 3) / 4];
+static uint16_t cycle_order[MAX_BOARD_CELLS];
+static int      cycle_width  = 0;
+static int      cycle_height = 0;
+static _Bool    cycle_valid  = 0;
+
+static void setNext(int idx, Direction dir)
+{
+  int shift = (idx & 3) * 2;
+  cycle_next[idx >> 2] = (cycle_next[idx >> 2] & ~(3 << shift)) | (dir << shift);
+}
+
+static Direction getNext(int idx)
+{
+  return (Direction) ((cycle_next[idx >> 2] >> ((idx & 3) * 2)) & 3);
+}
+
+/* Symbol: buildCycle
+ *   Costruisce il ciclo per una griglia [w]x[h]. Con [h] pari
+ *   il ciclo percorre le righe a serpentina dalla colonna 1
+ *   in poi e torna indietro lungo la colonna 0:
+ *
+ *     > > > > v
+ *     ^ v < < <
+ *     ^ > > > v
+ *     ^ < < < <
+ *
+ *   Con [h] dispari e [w] pari si fa lo stesso scambiando
+ *   righe e colonne. Se entrambe sono dispari un ciclo
+ *   hamiltoniano (senza passare dai bordi) non esiste e
+ *   [cycle_valid] resta a 0.
+ */
+static void buildCycle(int w, int h)
+{
+  cycle_width = w;
+  cycle_height = h;
+  cycle_valid = 0;
+
+  if (w < 2 || h < 2 || w * h > MAX_BOARD_CELLS || (w % 2 && h % 2)) {
+    Logger_printf("No hamiltonian cycle for a %dx%d board", w, h);
+    return;
+  }
+
+  for (int y = 0; y < h; ++y)
+    for (int x = 0; x < w; ++x) {
+      Direction dir;
+      if (h % 2 == 0) {
+        if (x == 0)
+          dir = (y == 0) ? DIR_RIGHT : DIR_UP;
+        else if (y % 2 == 0)
+          dir = (x == w-1) ? DIR_DOWN : DIR_RIGHT;
+        else if (x > 1)
+          dir = DIR_LEFT;
+        else
+          dir = (y == h-1) ? DIR_LEFT : DIR_DOWN;
+      } else {
+        if (y == 0)
+          dir = (x == 0) ? DIR_DOWN : DIR_LEFT;
+        else if (x % 2 == 0)
+          dir = (y == h-1) ? DIR_RIGHT : DIR_DOWN;
+        else if (y > 1)
+          dir = DIR_UP;
+        else
+          dir = (x == w-1) ? DIR_UP : DIR_RIGHT;
+      }
+      setNext(y * w + x, dir);
+    }
+
+  // Percorri il ciclo per numerare le celle.
+  Position pos = newPosition(0, 0);
+  for (int i = 0; i < w * h; ++i) {
+    int idx = pos.y * w + pos.x;
+    cycle_order[idx] = i;
+    pos = evaluateNextPosition(pos, getNext(idx));
+  }
+
+  cycle_valid = 1;
+}
+
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
+
+/* Symbol: cycleDistance
+ *   Numero di passi lungo il ciclo per andare da [from]
+ *   a [to].
+ */
+static int cycleDistance(Position from, Position to)
+{
+  const int cells = cycle_width * cycle_height;
+  int d = cycle_order[to.y * cycle_width + to.x]
+        - cycle_order[from.y * cycle_width + from.x];
+  return d < 0 ? d + cells : d;
+}
+
+static Direction chooseDirection(Game *game, int player)
+{
+  const int cells = cycle_width * cycle_height;
+
+  Position head  = Game_getPlayerHeadPosition(game, player);
+  Position tail  = Game_getPlayerTailPosition(game, player);
+  Position apple = Game_getApplePosition(game);
+  unsigned int size = Game_getPlayerSize(game, player);
+  Direction backwards = oppositeDirection(Game_getPlayerDirection(game, player));
+
+  Direction best_dir = getNext(head.y * cycle_width + head.x);
+  int best_distance = 1;
+
+  int tail_distance = (size == 1) ? cells : cycleDistance(head, tail);
+  int apple_distance = cycleDistance(head, apple);
+
+  // Le scorciatoie sono permesse solo finché il serpente
+  // occupa meno di metà griglia. Oltre questa soglia il
+  // serpente segue il ciclo e basta.
+  _Bool shortcuts = (int) size < cells / 2;
+
+  for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+
+    if (dir == backwards)
+      continue; // Il serpente non può tornare indietro.
+
+    int d = cycleDistance(head, evaluateNextPosition(head, dir));
+
+    if (best_dir == backwards) {
+      // Succede solo con un serpente lungo 1 la cui
+      // direzione è opposta a quella del ciclo: tutte le
+      // celle adiacenti sono libere, quindi va bene
+      // qualsiasi altra direzione.
+      best_dir = dir;
+      best_distance = d;
+    }
+
+    if (shortcuts && d > best_distance &&
+        d <= apple_distance && d < tail_distance - SHORTCUT_MARGIN) {
+      best_dir = dir;
+      best_distance = d;
+    }
+  }
+  return best_dir;
+}
+
+static Button getButton(Joystick *joystick, int player)
+{
+  HamiltonJoystick *joystick2 = (HamiltonJoystick*) joystick;
+  Game *game = (Game*) joystick2->game;
+
+  int w = Display_getWidth();
+  int h = Display_getHeight();
+  if (w != cycle_width || h != cycle_height)
+    buildCycle(w, h);
+
+  if (!cycle_valid) {
+    // Senza ciclo non si possono fare garanzie, quindi
+    // ci si limita a non perdere al prossimo update.
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir)
+      if (!Game_wouldLoseNextUpdateIf(game, player, dir))
+        return direction_buttons[dir];
+    return BUTTON_NULL;
+  }
+
+  return direction_buttons[chooseDirection(game, player)];
+}
+
+static JoystickMethodTable table = {
+  .getButton = getButton,
+  .free = 0,
+};
+
+void HamiltonJoystick_init(HamiltonJoystick *ai, void *game)
+{
+  ai->base.table = &table;
+  ai->game = game;
+}
@@ -0,0 +1,489 @@
+#include <stdint.h>
+#include <string.h>
+#include "game.h"
+#include "config.h"
+#include "logger.h"
+#include "joystick.h"
+
+/* Symbol: PathJoystick
+ *   Giocatore artificiale che segue un percorso pianificato
+ *   fino alla mela e lo conserva da un tick all'altro.
+ *
+ *   Ad ogni tick il percorso viene controllato contro il
+ *   modello del mondo: la cella k-esima del percorso è
+ *   valida se si libera entro k update (vedi il campo
+ *   [free_in] di [WorldModel]). Tra un tick e l'altro
+ *   cambiano solo le teste, le code e le crescite dei
+ *   serpenti, quindi di solito il percorso resta valido e
+ *   il controllo costa O(lunghezza del percorso).
+ *
+ *   Se una cella non è più valida (ad esempio perché un
+ *   avversario ci è passato sopra) il percorso viene
+ *   riparato localmente: una BFS limitata a REPAIR_MAX_VISITS
+ *   celle cerca una deviazione dall'ultima cella valida ad
+ *   una cella successiva del percorso. Il percorso viene
+ *   ricalcolato da zero solo quando la mela si sposta, quando
+ *   la testa non è dove ci si aspettava oppure quando la
+ *   riparazione fallisce.
+ *
+ *   Il numero di ricalcoli e di riparazioni si legge con
+ *   [PathJoystick_getReplans] e [PathJoystick_getRepairs].
+ *
+ * Nota: Le celle che si liberano non fanno ricalcolare il
+ *       percorso, che resta valido anche se potrebbe non
+ *       essere più il più breve.
+ */
+
+// Numero massimo di celle visitate da una riparazione
+// prima di arrendersi e ricalcolare tutto il percorso.
+#define REPAIR_MAX_VISITS 64
+
+/* Symbol: PathPlan
+ *   Percorso pianificato da un [PathJoystick]. Le celle
+ *   ancora da percorrere sono [cells][next .. length-1].
+ *   La testa si trova nella cella precedente [next] (oppure
+ *   in [origin] se [next] è 0).
+ */
+struct PathPlan {
+  Position cells[MAX_BOARD_CELLS];
+  unsigned int next;
+  unsigned int length;
+  Position origin;
+  Position apple;
+  _Bool    valid;
+};
+
+/* Symbol: plan_pool, plan_free_list, plan_pool_usage
+ *   Allocatore dei percorsi. Funziona come quello dei
+ *   serpenti in snake.c, quindi non è possibile avere più
+ *   di MAX_PATH_PLANS giocatori di questo tipo insieme.
+ */
+typedef union PathPlanSlot PathPlanSlot;
+union PathPlanSlot {
+  PathPlan plan;
+  PathPlanSlot *next;
+};
+
+static PathPlanSlot plan_pool[MAX_PATH_PLANS];
+static PathPlanSlot *plan_free_list = 0;
+static unsigned int plan_pool_usage = 0;
+
+static PathPlan *PathPlan_alloc(void)
+{
+  if (plan_free_list == 0) {
+    if (plan_pool_usage == 0) {
+      // È necessario costruire la freelist.
+      for (int i = 0; i < MAX_PATH_PLANS-1; ++i)
+        plan_pool[i].next = plan_pool + i + 1;
+      plan_pool[MAX_PATH_PLANS-1].next = 0;
+      plan_free_list = plan_pool;
+    } else {
+      Logger_printf("ERROR :: Couldn't allocate path plan");
+      return 0;
+    }
+  }
+
+  PathPlan *plan = &plan_free_list->plan;
+  plan_free_list = plan_free_list->next;
+  plan_pool_usage++;
+  return plan;
+}
+
+static void PathPlan_free(PathPlan *plan)
+{
+  PathPlanSlot *slot = (PathPlanSlot*) plan;
+  slot->next = plan_free_list;
+  plan_free_list = slot;
+  plan_pool_usage--;
+}
+
+/* Symbol: bfs_stamp, bfs_parent, bfs_dist, bfs_queue, target_stamp, bfs_target
+ *   Memoria di lavoro delle BFS, condivisa da tutti i
+ *   joystick perché le decisioni sono prese sotto
+ *   [Game_lock]. Una cella è stata visitata dalla BFS
+ *   corrente se il suo [bfs_stamp] è uguale a [stamp]:
+ *   così non serve azzerare le tabelle ad ogni ricerca ed
+ *   una riparazione costa solo le celle che visita.
+ *
+ *   [bfs_target] vale (j+1) per le celle che sono la j-esima
+ *   del percorso da riparare (se [target_stamp] coincide),
+ *   ed è usato per riconoscere le celle del percorso.
+ */
+static uint16_t stamp = 0;
+static uint16_t bfs_stamp[MAX_BOARD_CELLS];
+static uint16_t bfs_parent[MAX_BOARD_CELLS];
+static uint16_t bfs_dist[MAX_BOARD_CELLS];
+static Position bfs_queue[MAX_BOARD_CELLS];
+static uint16_t target_stamp[MAX_BOARD_CELLS];
+static uint16_t bfs_target[MAX_BOARD_CELLS];
+
+static uint16_t newStamp(void)
+{
+  stamp++;
+  if (stamp == 0) {
+    memset(bfs_stamp, 0, sizeof(bfs_stamp));
+    memset(target_stamp, 0, sizeof(target_stamp));
+    stamp = 1;
+  }
+  return stamp;
+}
+
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
+
+static _Bool samePosition(Position a, Position b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+/* Symbol: canEnter
+ *   Ritorna 1 se la testa di [player] può entrare nella
+ *   cella adiacente a [from] in direzione [dir] con la
+ *   mossa [offset]-esima a partire da ora. Per la
+ *   prima mossa si usano le direzioni sicure del modello,
+ *   che tengono conto anche delle teste degli avversari.
+ */
+static _Bool canEnter(const WorldModel *world, int player, Game *game,
+                      Position from, Direction dir, unsigned int offset)
+{
+  if (offset == 1) {
+    if (dir == oppositeDirection(Game_getPlayerDirection(game, player)))
+      return 0;
+    return (WorldModel_getSafeDirections(world, player) >> dir) & 1;
+  }
+  Position to = WorldModel_getNeighbour(world, from, dir);
+  return WorldModel_getFreeIn(world, to) <= offset;
+}
+
+/* Symbol: bfs
+ *   BFS che parte da [from] (raggiunta con [offset] mosse)
+ *   ed attraversa solo le celle in cui si può entrare in
+ *   tempo (vedi [canEnter]). Si ferma alla prima cella per
+ *   cui [isGoal] è vera, e ne ritorna l'indice, oppure dopo
+ *   [max_visits] celle ritornando -1.
+ *
+ *   Le celle con [target_stamp] uguale a [blocked_stamp] e
+ *   [bfs_target] uguale a 0 non sono attraversabili.
+ */
+typedef _Bool (*GoalFunction)(const WorldModel *world, int idx, void *data);
+
+static int bfs(const WorldModel *world, Game *game, int player,
+               Position from, unsigned int offset, unsigned int max_visits,
+               GoalFunction isGoal, void *data, uint16_t blocked_stamp)
+{
+  uint16_t s = newStamp();
+
+  int from_idx = WorldModel_cellIndex(world, from);
+  bfs_stamp[from_idx] = s;
+  bfs_dist[from_idx] = offset;
+
+  unsigned int head = 0;
+  unsigned int tail = 0;
+  bfs_queue[tail++] = from;
+
+  while (head < tail && head < max_visits) {
+
+    Position pos = bfs_queue[head++];
+    int pos_idx = WorldModel_cellIndex(world, pos);
+    unsigned int dist = bfs_dist[pos_idx] + 1;
+
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+
+      Position next = WorldModel_getNeighbour(world, pos, dir);
+      int idx = WorldModel_cellIndex(world, next);
+
+      if (bfs_stamp[idx] == s)
+        continue;
+      if (blocked_stamp && target_stamp[idx] == blocked_stamp && bfs_target[idx] == 0)
+        continue;
+      if (!canEnter(world, player, game, pos, dir, dist))
+        continue;
+
+      bfs_stamp[idx] = s;
+      bfs_dist[idx] = dist;
+      bfs_parent[idx] = pos_idx;
+
+      if (isGoal(world, idx, data))
+        return idx;
+
+      bfs_queue[tail++] = next;
+    }
+  }
+  return -1;
+}
+
+static Position cellPosition(const WorldModel *world, int idx)
+{
+  return (Position) { .x = idx % world->width, .y = idx / world->width };
+}
+
+/* Symbol: tracePath
+ *   Scrive in [out] le celle del percorso trovato da [bfs]
+ *   da [from_idx] (esclusa) a [to_idx] (inclusa) e ne
+ *   ritorna il numero.
+ */
+static unsigned int tracePath(const WorldModel *world, int from_idx, int to_idx,
+                              Position *out)
+{
+  unsigned int count = 0;
+  for (int idx = to_idx; idx != from_idx; idx = bfs_parent[idx])
+    count++;
+
+  unsigned int i = count;
+  for (int idx = to_idx; idx != from_idx; idx = bfs_parent[idx])
+    out[--i] = cellPosition(world, idx);
+  return count;
+}
+
+static _Bool isApple(const WorldModel *world, int idx, void *data)
+{
+  Position *apple = data;
+  return idx == WorldModel_cellIndex(world, *apple);
+}
+
+static _Bool isTarget(const WorldModel *world, int idx, void *data)
+{
+  (void) world;
+  uint16_t *s = data;
+  return target_stamp[idx] == *s && bfs_target[idx] != 0;
+}
+
+/* Symbol: PathJoystick_replan
+ *   Ricalcola da zero il percorso dalla testa alla mela.
+ */
+static void PathJoystick_replan(PathJoystick *ai, const WorldModel *world,
+                                Game *game, int player)
+{
+  PathPlan *plan = ai->plan;
+  Position head  = Game_getPlayerHeadPosition(game, player);
+  Position apple = Game_getApplePosition(game);
+
+  ai->replans++;
+
+  plan->valid  = 0;
+  plan->next   = 0;
+  plan->length = 0;
+  plan->origin = head;
+  plan->apple  = apple;
+
+  int goal = bfs(world, game, player, head, 0, MAX_BOARD_CELLS,
+                 isApple, &apple, 0);
+  if (goal < 0)
+    return; // La mela non è raggiungibile.
+
+  plan->length = tracePath(world, WorldModel_cellIndex(world, head),
+                           goal, plan->cells);
+  plan->valid = 1;
+}
+
+/* Symbol: PathJoystick_repair
+ *   Cerca una deviazione che eviti la cella [bad] del
+ *   percorso, partendo dalla cella precedente e tornando
+ *   su una delle celle successive. Le celle del percorso
+ *   prima di [bad] diventeranno parte del serpente, quindi
+ *   la deviazione non può passarci. Ritorna 0 se non esiste
+ *   una deviazione entro REPAIR_MAX_VISITS celle.
+ */
+static _Bool PathJoystick_repair(PathJoystick *ai, const WorldModel *world,
+                                 Game *game, int player, unsigned int bad)
+{
+  PathPlan *plan = ai->plan;
+
+  uint16_t s = newStamp();
+  for (unsigned int j = plan->next; j < plan->length; ++j) {
+    int idx = WorldModel_cellIndex(world, plan->cells[j]);
+    target_stamp[idx] = s;
+    bfs_target[idx] = (j > bad) ? j + 1 : 0;
+  }
+
+  Position anchor = (bad == plan->next) ? Game_getPlayerHeadPosition(game, player)
+                                        : plan->cells[bad-1];
+
+  int goal = bfs(world, game, player, anchor, bad - plan->next,
+                 REPAIR_MAX_VISITS, isTarget, &s, s);
+  if (goal < 0)
+    return 0;
+
+  // Sostituisci le celle [bad .. j-1] con la deviazione.
+  Position detour[REPAIR_MAX_VISITS + 1];
+  unsigned int j = bfs_target[goal] - 1;
+  unsigned int detour_length = tracePath(world, WorldModel_cellIndex(world, anchor),
+                                         goal, detour) - 1;
+
+  unsigned int suffix = plan->length - j;
+  if (bad + detour_length + suffix > MAX_BOARD_CELLS)
+    return 0;
+
+  memmove(plan->cells + bad + detour_length, plan->cells + j, suffix * sizeof(Position));
+  memcpy(plan->cells + bad, detour, detour_length * sizeof(Position));
+  plan->length = bad + detour_length + suffix;
+
+  ai->repairs++;
+  return 1;
+}
+
+/* Symbol: PathJoystick_findInvalid
+ *   Ritorna l'indice della prima cella del percorso in cui
+ *   la testa non potrà entrare in tempo, oppure [length]
+ *   se il percorso è tutto valido.
+ */
+static unsigned int PathJoystick_findInvalid(PathJoystick *ai, const WorldModel *world,
+                                             Game *game, int player)
+{
+  PathPlan *plan = ai->plan;
+  Position from = Game_getPlayerHeadPosition(game, player);
+
+  for (unsigned int k = plan->next; k < plan->length; ++k) {
+    Position to = plan->cells[k];
+    _Bool ok = 0;
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN && !ok; ++dir)
+      if (samePosition(WorldModel_getNeighbour(world, from, dir), to))
+        ok = canEnter(world, player, game, from, dir, k - plan->next + 1);
+    if (!ok)
+      return k;
+    from = to;
+  }
+  return plan->length;
+}
+
+/* Symbol: PathJoystick_update
+ *   Aggiorna il percorso allo stato attuale della partita,
+ *   riparandolo o ricalcolandolo se necessario.
+ */
+static void PathJoystick_update(PathJoystick *ai, const WorldModel *world,
+                                Game *game, int player)
+{
+  PathPlan *plan = ai->plan;
+  Position head  = Game_getPlayerHeadPosition(game, player);
+  Position apple = Game_getApplePosition(game);
+
+  if (plan->valid && plan->next < plan->length &&
+      samePosition(plan->cells[plan->next], head))
+    plan->next++; // La testa ha fatto un passo lungo il percorso.
+
+  Position expected = (plan->next == 0) ? plan->origin : plan->cells[plan->next-1];
+
+  if (!plan->valid || plan->next == plan->length ||
+      !samePosition(plan->apple, apple) || !samePosition(expected, head)) {
+    PathJoystick_replan(ai, world, game, player);
+    return;
+  }
+
+  unsigned int bad = PathJoystick_findInvalid(ai, world, game, player);
+  if (bad == plan->length)
+    return;
+
+  if (!PathJoystick_repair(ai, world, game, player, bad) ||
+      PathJoystick_findInvalid(ai, world, game, player) != plan->length)
+    PathJoystick_replan(ai, world, game, player);
+}
+
+/* Symbol: PathJoystick_isGoodMove
+ *   Ritorna 1 se la mossa [dir] è prudente (vedi
+ *   [WorldModel_getCautiousDirections], quando ce ne sono)
+ *   e lascia al serpente almeno tante celle quanto è lungo
+ *   (vedi [WorldModel_getMoveTerritory]).
+ *
+ *   Il percorso più breve verso la mela non guarda cosa
+ *   succede dopo averla mangiata, quindi senza questo
+ *   controllo il serpente entra nelle sacche e davanti
+ *   alle teste degli avversari.
+ */
+static _Bool PathJoystick_isGoodMove(const WorldModel *world, Game *game,
+                                     int player, unsigned int cautious, Direction dir)
+{
+  if (cautious != 0 && !((cautious >> dir) & 1))
+    return 0;
+  return WorldModel_getMoveTerritory(world, player, dir) >= Game_getPlayerSize(game, player);
+}
+
+static Button getButton(Joystick *joystick, int player)
+{
+  PathJoystick *ai = (PathJoystick*) joystick;
+  Game *game = (Game*) ai->game;
+  const WorldModel *world = Game_getWorldModel(game);
+
+  PathJoystick_update(ai, world, game, player);
+
+  PathPlan *plan = ai->plan;
+  Position head = Game_getPlayerHeadPosition(game, player);
+  unsigned int cautious = WorldModel_getCautiousDirections(world, player);
+
+  if (plan->valid)
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir)
+      if (samePosition(WorldModel_getNeighbour(world, head, dir), plan->cells[plan->next]) &&
+          PathJoystick_isGoodMove(world, game, player, cautious, dir))
+        return direction_buttons[dir];
+
+  // Senza un percorso buono si va verso la zona più
+  // grande, preferendo le direzioni prudenti. Al prossimo
+  // tick la testa non sarà dove il percorso la aspettava,
+  // e questo lo farà ricalcolare.
+  unsigned int allowed = cautious ? cautious : WorldModel_getSafeDirections(world, player);
+  Direction backwards = oppositeDirection(Game_getPlayerDirection(game, player));
+  Button best_button = BUTTON_NULL;
+  unsigned int best_territory = 0;
+  for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+    if (dir == backwards || !((allowed >> dir) & 1))
+      continue;
+    unsigned int territory = WorldModel_getMoveTerritory(world, player, dir);
+    if (best_button == BUTTON_NULL || territory > best_territory) {
+      best_button = direction_buttons[dir];
+      best_territory = territory;
+    }
+  }
+  if (best_button != BUTTON_NULL)
+    return best_button;
+
+  Logger_printf("Path player %d is trapped!", player);
+  return BUTTON_NULL;
+}
+
+static void freePath(Joystick *joystick)
+{
+  PathJoystick *ai = (PathJoystick*) joystick;
+  PathPlan_free(ai->plan);
+  ai->plan = 0;
+}
+
+static JoystickMethodTable table = {
+  .getButton = getButton,
+  .free = freePath,
+};
+
+/* Symbol: PathJoystick_init
+ *   Inizializza il joystick allocandone il percorso.
+ *   Ritorna 0 se sono già in uso MAX_PATH_PLANS percorsi.
+ *   Il joystick va distrutto con [Joystick_free].
+ */
+_Bool PathJoystick_init(PathJoystick *ai, void *game)
+{
+  PathPlan *plan = PathPlan_alloc();
+  if (plan == 0)
+    return 0;
+
+  plan->valid = 0;
+  plan->next = 0;
+  plan->length = 0;
+
+  ai->base.table = &table;
+  ai->game = game;
+  ai->plan = plan;
+  ai->replans = 0;
+  ai->repairs = 0;
+  return 1;
+}
+
+unsigned int PathJoystick_getReplans(PathJoystick *ai)
+{
+  return ai->replans;
+}
+
+unsigned int PathJoystick_getRepairs(PathJoystick *ai)
+{
+  return ai->repairs;
+}
@@ -0,0 +1,202 @@
+#include <stdint.h>
+#include <string.h>
+#include "ch.h"
+#include "game.h"
+#include "config.h"
+#include "logger.h"
+#include "joystick.h"
+#include "policy_weights.h"
+
+/* Symbol: PolicyJoystick
+ *   Giocatore artificiale guidato da una piccola rete
+ *   neurale addestrata sull'host da tools/train_policy.py.
+ *
+ *   Gli ingressi sono caratteristiche locali della griglia,
+ *   viste dal serpente (cioè ruotate in modo che la sua
+ *   direzione sia "avanti"):
+ *
+ *     - le celle di una finestra (2*POLICY_WINDOW+1)^2
+ *       attorno alla testa, che valgono POLICY_INPUT_ONE se
+ *       saranno ancora occupate dopo il prossimo update o se
+ *       ci arriverà la testa di un avversario;
+ *     - per ognuna delle tre mosse (sinistra, dritto e
+ *       destra) se porta nella cella più vicina alla mela
+ *       (POLICY_INPUT_ONE) oppure in una cella da cui la
+ *       mela non è raggiungibile (-POLICY_INPUT_ONE).
+ *
+ *   Le uscite sono i punteggi delle tre mosse. Tra le mosse
+ *   sicure (vedi [WorldModel_getSafeDirections]) viene scelta
+ *   quella col punteggio più alto.
+ *
+ *   La scheda non usa la FPU (USE_FPU = no nel Makefile),
+ *   quindi l'inferenza è fatta solo con interi: pesi int8 e
+ *   somme su int32. Una decisione costa circa 250
+ *   moltiplicazioni, molto meno di un tick.
+ */
+
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
+
+static const Direction turn_left[] = {
+  [DIR_UP]    = DIR_LEFT,
+  [DIR_LEFT]  = DIR_DOWN,
+  [DIR_DOWN]  = DIR_RIGHT,
+  [DIR_RIGHT] = DIR_UP,
+};
+
+static const Direction turn_right[] = {
+  [DIR_UP]    = DIR_RIGHT,
+  [DIR_RIGHT] = DIR_DOWN,
+  [DIR_DOWN]  = DIR_LEFT,
+  [DIR_LEFT]  = DIR_UP,
+};
+
+static const int8_t direction_dx[] = { [DIR_LEFT] = -1, [DIR_RIGHT] = 1, [DIR_UP] =  0, [DIR_DOWN] = 0 };
+static const int8_t direction_dy[] = { [DIR_LEFT] =  0, [DIR_RIGHT] = 0, [DIR_UP] = -1, [DIR_DOWN] = 1 };
+
+/* Symbol: dotInt8
+ *   Prodotto scalare di due vettori int8 lunghi [n] (multiplo
+ *   di 4), accumulato su int32.
+ *
+ *   Sui Cortex-M4 si usano le istruzioni DSP come in CMSIS-NN:
+ *   SXTB16 estende con segno due byte alla volta in due int16,
+ *   e SMLAD moltiplica ed accumula due coppie di int16 in una
+ *   sola istruzione, quindi 4 byte costano 6 istruzioni invece
+ *   di 4 caricamenti, 4 estensioni e 4 moltiplicazioni.
+ */
+static int32_t dotInt8(const int8_t *a, const int8_t *b, unsigned int n)
+{
+  int32_t acc = 0;
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP == 1
+  for (unsigned int i = 0; i < n; i += 4) {
+    uint32_t wa, wb;
+    memcpy(&wa, a + i, 4);
+    memcpy(&wb, b + i, 4);
+    acc = __SMLAD(__SXTB16(wa), __SXTB16(wb), acc);
+    acc = __SMLAD(__SXTB16(__ROR(wa, 8)), __SXTB16(__ROR(wb, 8)), acc);
+  }
+#else
+  for (unsigned int i = 0; i < n; ++i)
+    acc += a[i] * b[i];
+#endif
+
+  return acc;
+}
+
+/* Symbol: computeFeatures
+ *   Calcola gli ingressi della rete per il giocatore [player].
+ *   Deve restare identica a [features] in tools/train_policy.py.
+ */
+static void computeFeatures(Game *game, const WorldModel *world, int player,
+                            int8_t inputs[POLICY_INPUTS])
+{
+  Position  head = Game_getPlayerHeadPosition(game, player);
+  Direction dir  = Game_getPlayerDirection(game, player);
+
+  int fx = direction_dx[dir];
+  int fy = direction_dy[dir];
+  int rx = direction_dx[turn_right[dir]];
+  int ry = direction_dy[turn_right[dir]];
+
+  unsigned int n = 0;
+  for (int f = POLICY_WINDOW; f >= -POLICY_WINDOW; --f)
+    for (int r = -POLICY_WINDOW; r <= POLICY_WINDOW; ++r) {
+      if (f == 0 && r == 0)
+        continue;
+      Position pos = newPosition(head.x + f * fx + r * rx,
+                                 head.y + f * fy + r * ry);
+      _Bool occupied = WorldModel_getFreeIn(world, pos) > 1 ||
+                       WorldModel_isOpponentHeadAt(world, player, pos);
+      inputs[n++] = occupied ? POLICY_INPUT_ONE : 0;
+    }
+
+  const Direction actions[] = { turn_left[dir], dir, turn_right[dir] };
+  unsigned int distances[3];
+  unsigned int best = WORLD_UNREACHABLE;
+  for (unsigned int a = 0; a < 3; ++a) {
+    Position next = WorldModel_getNeighbour(world, head, actions[a]);
+    distances[a] = WorldModel_getAppleDistance(world, next);
+    if (distances[a] < best)
+      best = distances[a];
+  }
+  for (unsigned int a = 0; a < 3; ++a) {
+    if (distances[a] == WORLD_UNREACHABLE)
+      inputs[n++] = -POLICY_INPUT_ONE;
+    else
+      inputs[n++] = (distances[a] == best) ? POLICY_INPUT_ONE : 0;
+  }
+
+  while (n < POLICY_INPUTS)
+    inputs[n++] = 0;
+}
+
+/* Symbol: evaluatePolicy
+ *   Calcola i punteggi delle tre mosse a partire dagli
+ *   ingressi [inputs].
+ */
+static void evaluatePolicy(const int8_t inputs[POLICY_INPUTS],
+                           int32_t scores[POLICY_OUTPUTS])
+{
+  int8_t hidden[POLICY_HIDDEN] __attribute__((aligned(4)));
+
+  for (int j = 0; j < POLICY_HIDDEN; ++j) {
+    int32_t acc = dotInt8(policy_w1[j], inputs, POLICY_INPUTS) + policy_b1[j];
+    if (acc < 0)
+      acc = 0; // ReLU
+    acc >>= policy_hidden_shift;
+    hidden[j] = (acc > 127) ? 127 : acc;
+  }
+
+  for (int k = 0; k < POLICY_OUTPUTS; ++k)
+    scores[k] = dotInt8(policy_w2[k], hidden, POLICY_HIDDEN) + policy_b2[k];
+}
+
+static Button getButton(Joystick *joystick, int player)
+{
+  PolicyJoystick *ai = (PolicyJoystick*) joystick;
+  Game *game = (Game*) ai->game;
+  const WorldModel *world = Game_getWorldModel(game);
+
+  int8_t  inputs[POLICY_INPUTS] __attribute__((aligned(4)));
+  int32_t scores[POLICY_OUTPUTS];
+
+  computeFeatures(game, world, player, inputs);
+  evaluatePolicy(inputs, scores);
+
+  Direction dir = Game_getPlayerDirection(game, player);
+  const Direction actions[] = { turn_left[dir], dir, turn_right[dir] };
+  unsigned int safe = WorldModel_getSafeDirections(world, player);
+
+  Direction best_dir = dir;
+  _Bool found = 0;
+  int32_t best_score = 0;
+  for (unsigned int a = 0; a < 3; ++a) {
+    if (!((safe >> actions[a]) & 1))
+      continue;
+    if (!found || scores[a] > best_score) {
+      best_dir = actions[a];
+      best_score = scores[a];
+      found = 1;
+    }
+  }
+
+  if (!found)
+    Logger_printf("Policy player %d is trapped!", player);
+  return direction_buttons[best_dir];
+}
+
+static JoystickMethodTable table = {
+  .getButton = getButton,
+  .free = 0,
+};
+
+void PolicyJoystick_init(PolicyJoystick *ai, void *game)
+{
+  ai->base.table = &table;
+  ai->game = game;
+}
@@ -1,3 +1,4 @@
+#include "game.h"
 #include "utils.h"
 #include "logger.h"
 #include "joystick.h"
@@ -12,7 +13,9 @@ static JoystickMethodTable table = {
 void RandomJoystick_init2(RandomJoystick *joystick, int seed)
 {
   joystick->base.table = &table;
-  joystick->seed = seed;
+  Rng_init(&joystick->rng, seed);
+  joystick->batch_next = RANDOM_JOYSTICK_BATCH;
+  joystick->game = 0;
 }
 
 void RandomJoystick_init(RandomJoystick *joystick)
@@ -20,16 +23,81 @@ void RandomJoystick_init(RandomJoystick *joystick)
   return RandomJoystick_init2(joystick, generateRandomInteger());
 }
 
-static Button getButton(Joystick *joystick, int player)
+/* Symbol: RandomJoystick_initSafe
+ *   Come [RandomJoystick_init2], ma il joystick sceglie
+ *   a caso solo tra le direzioni che non lo fanno perdere
+ *   al prossimo update di [game]. Un giocatore del genere
+ *   sopravvive a lungo e costa una sola lettura della
+ *   maschera delle direzioni sicure del modello del mondo,
+ *   quindi è adatto a generare carico nelle partite.
+ */
+void RandomJoystick_initSafe(RandomJoystick *joystick, void *game, int seed)
 {
-  (void) player;
+  RandomJoystick_init2(joystick, seed);
+  joystick->game = game;
+}
 
-  RandomJoystick *joystick2 = (RandomJoystick*) joystick;
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
+
+/* Symbol: nextRandom
+ *   Ritorna un intero uniforme in [0, 12), preso dal blocco
+ *   di numeri del joystick, che viene riempito con
+ *   [Rng_fillBounded] quando è esaurito.
+ *
+ *   12 è divisibile per 1, 2, 3, 4 e 6, quindi il resto
+ *   della divisione per il numero di direzioni sicure o per
+ *   BUTTON_COUNT è ancora uniforme.
+ */
+#define RANDOM_RANGE 12
+
+static unsigned int nextRandom(RandomJoystick *joystick)
+{
+  if (joystick->batch_next == RANDOM_JOYSTICK_BATCH) {
+    Rng_fillBounded(&joystick->rng, RANDOM_RANGE, joystick->batch, RANDOM_JOYSTICK_BATCH);
+    joystick->batch_next = 0;
+  }
+  return joystick->batch[joystick->batch_next++];
+}
+
+/* Symbol: generateSafeButton
+ *   Sceglie uniformemente una delle direzioni sicure
+ *   per [player]. Se non ce ne sono, il serpente è
+ *   comunque spacciato e viene ritornato [BUTTON_NULL].
+ */
+static Button generateSafeButton(RandomJoystick *joystick, int player)
+{
+  Game *game = (Game*) joystick->game;
+
+  unsigned int mask = WorldModel_getSafeDirections(Game_getWorldModel(game), player);
+
+  // Tornare indietro è sempre ignorato da [Snake_changeDirection].
+  mask &= ~(1u << oppositeDirection(Game_getPlayerDirection(game, player)));
 
-  int random_integer = generateRandomPositiveIntegerUsingSeed(joystick2->seed);
-  joystick2->seed = random_integer;
+  unsigned int count = __builtin_popcount(mask);
+  if (count == 0)
+    return BUTTON_NULL;
+
+  // Prendi il k-esimo bit a 1 della maschera.
+  unsigned int k = nextRandom(joystick) % count;
+  while (k--)
+    mask &= mask - 1;
+  return direction_buttons[__builtin_ctz(mask)];
+}
+
+static Button getButton(Joystick *joystick, int player)
+{
+  RandomJoystick *joystick2 = (RandomJoystick*) joystick;
 
-  Button generated_button = (random_integer % BUTTON_COUNT);
+  Button generated_button;
+  if (joystick2->game)
+    generated_button = generateSafeButton(joystick2, player);
+  else
+    generated_button = nextRandom(joystick2) % BUTTON_COUNT;
 
   Logger_printf("Random Joystick generated %s", buttonName(generated_button));
 
@@ -0,0 +1,879 @@
+#include <stdint.h>
+#include <string.h>
+#include "game.h"
+#include "config.h"
+#include "logger.h"
+#include "joystick.h"
+#include "transposition.h"
+#include "budget.h"
+#include "endgame.h"
+
+/* Symbol: SearchJoystick
+ *   Giocatore artificiale che esplora tutte le sequenze
+ *   di AI_SEARCH_DEPTH mosse del proprio serpente e sceglie
+ *   la prima mossa di quella che lo fa sopravvivere più a
+ *   lungo, mangiando la mela il prima possibile o almeno
+ *   finendo il più vicino possibile ad essa.
+ *
+ *   Gli avversari sono considerati fermi: le loro celle si
+ *   liberano man mano che le code avanzano (vedi il campo
+ *   [free_in] di [WorldModel]) e solo alla prima mossa si
+ *   evitano le loro teste possibili (la prima mossa è scelta
+ *   tra le direzioni prudenti del modello, o tra quelle
+ *   sicure se non ce ne sono).
+ *
+ *   Tra le prime mosse che sopravvivono allo stesso numero
+ *   di mosse conta, oltre alla mela, il vantaggio di
+ *   territorio sugli avversari (vedi [moveLead]): così il
+ *   serpente toglie spazio agli avversari invece di
+ *   lasciarsi chiudere mentre insegue la mela.
+ *
+ *   La stessa posizione si può raggiungere con ordini di
+ *   mosse diversi (ad esempio destra-giù e giù-destra),
+ *   quindi i valori delle posizioni già esplorate sono
+ *   memorizzati in una [TranspositionTable] usando come
+ *   chiave l'hash di Zobrist della partita (vedi
+ *   [Game_getHash]) aggiornato ad ogni mossa della ricerca.
+ *
+ *   Con un [AIBudget] (vedi [SearchJoystick_setBudget]) la
+ *   ricerca è ripetuta con profondità 1, 2, ... fino ad
+ *   AI_SEARCH_DEPTH e si ferma quando la parte del frame del
+ *   giocatore è esaurita. Si usa la mossa dell'ultima
+ *   profondità completata; la prima è sempre completata.
+ *   Nella parte del frame è contato tutto il lavoro della
+ *   decisione, anche la costruzione del modello del mondo
+ *   e il vantaggio di territorio (vedi [computeLeads]).
+ *
+ *   Quando il serpente è rimasto solo e restano poche celle
+ *   libere la mossa scelta è verificata con
+ *   [Endgame_findSafeMove] come in [AIJoystick].
+ *
+ *   Per le analisi e i tornei sull'host (Linux) si può
+ *   compilare con AI_SEARCH_WORKERS > 1: senza budget, le
+ *   coppie delle prime due mosse sono divise tra i thread
+ *   scelti con [SearchJoystick_setWorkers] (vedi
+ *   [searchSplit]) ed i risultati sono uniti nell'ordine
+ *   delle direzioni, quindi a parità di seme e di thread le
+ *   partite sono sempre le stesse. Sulla scheda
+ *   AI_SEARCH_WORKERS vale 1 e la ricerca resta sequenziale.
+ */
+
+#if AI_SEARCH_WORKERS > 1
+#ifndef __linux__
+#error "AI_SEARCH_WORKERS > 1 is only supported on Linux hosts"
+#endif
+#include <pthread.h>
+#endif
+
+// Punteggio per ogni mossa sopravvissuta. È maggiore
+// della somma di tutti gli altri termini, così che la
+// sopravvivenza abbia sempre la precedenza.
+#define SURVIVAL_SCORE 1000
+
+// Punteggio per la mela, moltiplicato per il numero di
+// mosse rimaste quando viene mangiata.
+#define APPLE_SCORE 64
+
+// Distanza dalla mela oltre la quale tutte le celle
+// sono considerate ugualmente lontane.
+#define MAX_APPLE_DISTANCE 255
+
+// Punteggio per ogni cella di vantaggio sugli avversari
+// nel territorio di una prima mossa (vedi [moveLead]).
+#define TERRITORY_SCORE 8
+
+// Punteggio per ogni mossa sopravvissuta nel confronto tra
+// le prime mosse (vedi [rootScore]). È maggiore di ogni
+// differenza tra gli altri termini, come SURVIVAL_SCORE.
+#define ROOT_SURVIVAL_SCORE (2 * (SURVIVAL_SCORE + TERRITORY_SCORE * MAX_BOARD_CELLS))
+
+static const Button direction_buttons[] = {
+  [DIR_LEFT]  = BUTTON_LEFT,
+  [DIR_RIGHT] = BUTTON_RIGHT,
+  [DIR_UP]    = BUTTON_UP,
+  [DIR_DOWN]  = BUTTON_DOWN,
+};
+
+typedef struct SearchFrame SearchFrame;
+
+/* Symbol: SearchContext
+ *   Stato condiviso dai livelli della ricerca.
+ *
+ *   [free_in] è una copia dell'omonimo campo del modello
+ *   del mondo, modificata durante la ricerca: la cella in
+ *   cui entra la testa alla mossa [step] si libera alla
+ *   mossa (step + size), e viene ripristinata tornando
+ *   indietro. [frames] è la pila della ricerca (vedi
+ *   [search]). Entrambe sono quelle statiche di questo
+ *   file, oppure quelle di un thread di [searchSplit].
+ */
+typedef struct {
+  const WorldModel   *world;
+  TranspositionTable *table;
+  int          player;
+  unsigned int size;
+  Position     apple;
+
+  // Profondità della ricerca corrente.
+  unsigned int depth;
+
+  // Budget di tempo (0 se la ricerca non si interrompe)
+  // ed indicatore di ricerca interrotta.
+  AIBudget *budget;
+  int       bot;
+  _Bool     aborted;
+
+  // Celle in cui è entrata la testa ad ogni mossa.
+  Position path[AI_SEARCH_DEPTH + 1];
+
+  // Vantaggio di territorio di ogni prima mossa.
+  int lead[4];
+
+  uint16_t    *free_in;
+  SearchFrame *frames;
+} SearchContext;
+
+// La ricerca avviene sempre sotto [Game_lock], quindi
+// una sola copia è sufficiente per tutti i joystick.
+static uint16_t free_in[MAX_BOARD_CELLS];
+
+/* Symbol: lead_owner, lead_distance, lead_queue
+ *   Stato della visita di [moveLead]: per ogni cella chi la
+ *   raggiunge per primo ed a che distanza, e la coda della
+ *   BFS. Come [free_in] basta una copia.
+ */
+#define LEAD_NONE      0
+#define LEAD_OWN       1
+#define LEAD_OTHER     2
+#define LEAD_CONTESTED 3
+
+static uint8_t  lead_owner[MAX_BOARD_CELLS];
+static uint16_t lead_distance[MAX_BOARD_CELLS];
+static Position lead_queue[MAX_BOARD_CELLS];
+
+static int leadVisit(const WorldModel *world, Position pos, uint8_t owner,
+                     uint16_t distance, int tail)
+{
+  int idx = WorldModel_cellIndex(world, pos);
+  if (lead_owner[idx] == LEAD_NONE) {
+    lead_owner[idx] = owner;
+    lead_distance[idx] = distance;
+    lead_queue[tail++] = pos;
+  } else if (lead_distance[idx] == distance && lead_owner[idx] != owner)
+    lead_owner[idx] = LEAD_CONTESTED;
+  return tail;
+}
+
+/* Symbol: moveLead
+ *   Ritorna quante celle in più degli avversari raggiunge
+ *   per primo il giocatore [player] se la sua prossima
+ *   mossa è [dir] (negativo se ne raggiunge meno).
+ *
+ *   È la BFS di [WorldModel_computeTerritory] con una sola
+ *   sorgente per [player], la cella in cui entra con [dir],
+ *   e le direzioni sicure degli avversari come sorgenti
+ *   degli avversari: il territorio del modello del mondo
+ *   vale per tutte le mosse di [player] insieme e non dice
+ *   quanto spazio resta agli avversari dopo una mossa.
+ */
+static int moveLead(const WorldModel *world, Game *game, int player, Direction dir)
+{
+  const int cells = world->width * world->height;
+  memset(lead_owner, LEAD_NONE, cells);
+
+  Position start = WorldModel_getNeighbour(world, Game_getPlayerHeadPosition(game, player), dir);
+  int head = 0;
+  int tail = leadVisit(world, start, LEAD_OWN, 1, 0);
+
+  for (int i = 0; i < world->player_count; ++i) {
+    unsigned int safe = WorldModel_getSafeDirections(world, i);
+    if (i == player || safe == 0)
+      continue;
+    Position opponent = Game_getPlayerHeadPosition(game, i);
+    for (Direction next_dir = DIR_LEFT; next_dir <= DIR_DOWN; ++next_dir)
+      if ((safe >> next_dir) & 1)
+        tail = leadVisit(world, WorldModel_getNeighbour(world, opponent, next_dir),
+                         LEAD_OTHER, 1, tail);
+  }
+
+  int lead = 0;
+  while (head < tail) {
+    Position pos = lead_queue[head++];
+    int idx = WorldModel_cellIndex(world, pos);
+
+    uint8_t owner = lead_owner[idx];
+    if (owner == LEAD_CONTESTED)
+      continue;
+    lead += (owner == LEAD_OWN) ? 1 : -1;
+
+    uint16_t distance = lead_distance[idx] + 1;
+    for (Direction next_dir = DIR_LEFT; next_dir <= DIR_DOWN; ++next_dir) {
+      Position next = WorldModel_getNeighbour(world, pos, next_dir);
+      if (world->free_in[WorldModel_cellIndex(world, next)] <= distance)
+        tail = leadVisit(world, next, owner, distance, tail);
+    }
+  }
+  return lead;
+}
+
+/* Symbol: computeLeads
+ *   Calcola [lead] per le prime mosse sicure. Ogni mossa
+ *   costa una visita della griglia che non si interrompe,
+ *   quindi prima di ognuna si controlla il budget: se la
+ *   parte del frame è esaurita il vantaggio vale 0 per
+ *   tutte le mosse, così che nessuna sia favorita.
+ */
+static void computeLeads(SearchContext *ctx, Game *game)
+{
+  unsigned int safe = WorldModel_getSafeDirections(ctx->world, ctx->player);
+  for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+    if (ctx->budget && AIBudget_expired(ctx->budget, ctx->bot)) {
+      memset(ctx->lead, 0, sizeof(ctx->lead));
+      return;
+    }
+    ctx->lead[dir] = ((safe >> dir) & 1) ? moveLead(ctx->world, game, ctx->player, dir) : 0;
+  }
+}
+
+/* Symbol: rootScore
+ *   Ritorna il punteggio con cui si confrontano le prime
+ *   mosse: la prima mossa [dir] di valore [value] vale
+ *   prima di tutto per le mosse sopravvissute, poi per la
+ *   mela e per il suo vantaggio di territorio.
+ */
+static int rootScore(const SearchContext *ctx, Direction dir, int value)
+{
+  return (value / SURVIVAL_SCORE) * ROOT_SURVIVAL_SCORE
+       + value % SURVIVAL_SCORE
+       + ctx->lead[dir] * TERRITORY_SCORE;
+}
+
+/* Symbol: SearchMove
+ *   Mossa generata da [generateMoves]: posizione e direzione
+ *   della testa dopo la mossa, hash della nuova posizione,
+ *   indice della cella, punteggio della mela eventualmente
+ *   mangiata e se la mela è stata mangiata finora.
+ */
+typedef struct {
+  Position  pos;
+  Direction dir;
+  uint32_t  key;
+  int       idx;
+  int       bonus;
+  _Bool     eaten;
+} SearchMove;
+
+static uint32_t directionKey(int player, Direction dir)
+{
+  return zobristKey(ZobristPiece_DIRECTION, player, (Position) { .x = dir, .y = 0 });
+}
+
+static uint32_t stepKey(int player, unsigned int step)
+{
+  return zobristKey(ZobristPiece_STEP, player, (Position) { .x = step, .y = 0 });
+}
+
+static int evaluateLeaf(SearchContext *ctx, Position pos, _Bool eaten)
+{
+  int value = ctx->depth * SURVIVAL_SCORE;
+  if (eaten)
+    return value + MAX_APPLE_DISTANCE;
+
+  unsigned int distance = WorldModel_getAppleDistance(ctx->world, pos);
+  if (distance > MAX_APPLE_DISTANCE)
+    distance = MAX_APPLE_DISTANCE;
+  return value + MAX_APPLE_DISTANCE - distance;
+}
+
+/* Symbol: firstDirections
+ *   Ritorna le direzioni tra cui si sceglie la prima mossa:
+ *   quelle prudenti del modello, o quelle sicure se non ce
+ *   ne sono.
+ */
+static unsigned int firstDirections(const WorldModel *world, int player)
+{
+  unsigned int allowed = WorldModel_getCautiousDirections(world, player);
+  if (allowed == 0)
+    allowed = WorldModel_getSafeDirections(world, player);
+  return allowed;
+}
+
+/* Symbol: generateMoves
+ *   Scrive in [moves] le mosse possibili dalla posizione in
+ *   cui la testa è in [pos] con direzione [dir] dopo [step]
+ *   mosse, nell'ordine delle direzioni, e ne ritorna il
+ *   numero. L'hash [key] della posizione è aggiornato come
+ *   descritto in [search].
+ */
+static unsigned int generateMoves(SearchContext *ctx, Position pos, Direction dir,
+                                  unsigned int step, uint32_t key, _Bool eaten,
+                                  SearchMove moves[3])
+{
+  unsigned int count = 0;
+
+  for (Direction next_dir = DIR_LEFT; next_dir <= DIR_DOWN; ++next_dir) {
+
+    if (next_dir == oppositeDirection(dir))
+      continue;
+
+    Position next = evaluateNextPosition(pos, next_dir);
+    int idx = WorldModel_cellIndex(ctx->world, next);
+
+    if (step == 0) {
+      if (!(firstDirections(ctx->world, ctx->player) & (1 << next_dir)))
+        continue;
+    } else if (ctx->free_in[idx] > step + 1)
+      continue;
+
+    uint32_t next_key = key
+      ^ zobristKey(ZobristPiece_HEAD, ctx->player, pos)
+      ^ zobristKey(ZobristPiece_HEAD, ctx->player, next)
+      ^ zobristKey(ZobristPiece_BODY, ctx->player, next)
+      ^ stepKey(ctx->player, step)
+      ^ stepKey(ctx->player, step + 1);
+
+    // Le celle del corpo iniziale si liberano allo stesso
+    // modo qualunque mossa si faccia, quindi basta il numero
+    // di mosse. Quelle attraversate dalla ricerca si tolgono
+    // dalla chiave quando la coda le lascia.
+    if (step + 1 > ctx->size)
+      next_key ^= zobristKey(ZobristPiece_BODY, ctx->player,
+                             ctx->path[step + 1 - ctx->size]);
+
+    // La direzione conta solo per un serpente lungo 1: per
+    // gli altri la cella alle spalle è comunque occupata.
+    // Ignorandola, le sequenze di mosse che attraversano
+    // le stesse celle finiscono nella stessa posizione.
+    if (ctx->size == 1)
+      next_key ^= directionKey(ctx->player, dir)
+                ^ directionKey(ctx->player, next_dir);
+
+    int bonus = 0;
+    _Bool eats = !eaten && next.x == ctx->apple.x && next.y == ctx->apple.y;
+    if (eats) {
+      bonus = (ctx->depth - step) * APPLE_SCORE;
+      next_key ^= zobristKey(ZobristPiece_APPLE, ctx->player + 1, newPosition(0, 0));
+    }
+
+    moves[count++] = (SearchMove) {
+      .pos   = next,
+      .dir   = next_dir,
+      .key   = next_key,
+      .idx   = idx,
+      .bonus = bonus,
+      .eaten = eaten || eats,
+    };
+  }
+  return count;
+}
+
+/* Symbol: SearchFrame
+ *   Livello della ricerca di [search] alla mossa [step]:
+ *   [key] è l'hash della posizione, [moves] le mosse
+ *   possibili da lì, [next] la prossima da provare e [best]
+ *   il valore migliore trovato finora. [saved] è il valore
+ *   di [free_in] nella cella della mossa in corso, da
+ *   ripristinare tornando indietro.
+ */
+struct SearchFrame {
+  uint32_t     key;
+  SearchMove   moves[3];
+  unsigned int count;
+  unsigned int next;
+  int          best;
+  uint16_t     saved;
+};
+
+// Pila esplicita di [search], indicizzata dalla mossa:
+// AI_SEARCH_DEPTH livelli ricorsivi peserebbero sullo
+// stack del thread che decide (vedi MAIN_STACK_USAGE).
+// Come [free_in] basta una copia per tutti i joystick.
+static SearchFrame frames[AI_SEARCH_DEPTH];
+
+/* Symbol: enterFrame
+ *   Inizia la valutazione della posizione in cui la testa
+ *   è in [pos] con direzione [dir] dopo [step] mosse.
+ *
+ *   Se il valore si conosce subito (foglia, posizione già
+ *   nella tabella delle trasposizioni o ricerca interrotta)
+ *   lo scrive in [value] e ritorna 1; altrimenti prepara il
+ *   livello [step] di [frames] e ritorna 0.
+ */
+static _Bool enterFrame(SearchContext *ctx, Position pos, Direction dir,
+                        unsigned int step, uint32_t key, _Bool eaten,
+                        int *value)
+{
+  if (step == ctx->depth) {
+    *value = evaluateLeaf(ctx, pos, eaten);
+    return 1;
+  }
+
+  // La profondità 1 non si interrompe, così
+  // c'è sempre una mossa da fare.
+  if (ctx->budget && ctx->depth > 1 && AIBudget_expired(ctx->budget, ctx->bot)) {
+    ctx->aborted = 1;
+    *value = 0;
+    return 1;
+  }
+
+  // La posizione iniziale va sempre esplorata,
+  // perché serve la mossa migliore.
+  if (step > 0 && TranspositionTable_probe(ctx->table, key, ctx->depth - step, value))
+    return 1;
+
+  SearchFrame *frame = &ctx->frames[step];
+  frame->key = key;
+  frame->count = generateMoves(ctx, pos, dir, step, key, eaten, frame->moves);
+  frame->next = 0;
+
+  // Se nessuna mossa è possibile il serpente
+  // sopravvive solo le mosse fatte finora.
+  frame->best = step * SURVIVAL_SCORE;
+  return 0;
+}
+
+/* Symbol: search
+ *   Ritorna il valore della posizione in cui la testa è in
+ *   [pos] con direzione [dir] dopo [root] mosse e, se [root]
+ *   è 0, scrive in [best_dir] la direzione della mossa
+ *   migliore. Il valore di una posizione dopo [step] mosse
+ *   non comprende le mele mangiate nelle mosse precedenti.
+ *
+ *   [key] è l'hash della posizione ed è aggiornato come
+ *   farebbe [Snake_step]: la testa si sposta, la cella
+ *   in cui entra si aggiunge al corpo e quella da cui
+ *   esce la coda si toglie. Contiene inoltre il numero
+ *   di mosse (da cui dipende quali celle degli avversari
+ *   sono libere) e se la mela è già stata mangiata. Due
+ *   ordini di mosse che lasciano il serpente nelle stesse
+ *   celle producono la stessa chiave.
+ *
+ *   La visita è in profondità su [frames] invece che
+ *   ricorsiva, così lo stack usato non dipende da
+ *   AI_SEARCH_DEPTH.
+ *
+ *   La mossa migliore è quella col [rootScore] più alto.
+ *
+ *   Se la ricerca viene interrotta dal budget il valore
+ *   ritornato non ha senso e non viene memorizzato.
+ */
+static int search(SearchContext *ctx, Position pos, Direction dir, unsigned int root,
+                  uint32_t key, _Bool eaten, Direction *best_dir)
+{
+  int value;
+  if (enterFrame(ctx, pos, dir, root, key, eaten, &value))
+    return value;
+
+  int best_score = 0;
+
+  unsigned int step = root;
+  for (;;) {
+    SearchFrame *frame = &ctx->frames[step];
+
+    if (frame->next < frame->count) {
+      const SearchMove *move = &frame->moves[frame->next++];
+      frame->saved = ctx->free_in[move->idx];
+      ctx->free_in[move->idx] = step + 1 + ctx->size;
+      ctx->path[step + 1] = move->pos;
+      if (!enterFrame(ctx, move->pos, move->dir, step + 1,
+                      move->key, move->eaten, &value)) {
+        step++;
+        continue;
+      }
+    } else {
+      // Tutte le mosse sono state valutate.
+      TranspositionTable_store(ctx->table, frame->key, ctx->depth - step, frame->best);
+      if (step == root)
+        return frame->best;
+      value = frame->best;
+      frame = &ctx->frames[--step];
+    }
+
+    // [value] è il valore della mossa in corso di [frame].
+    const SearchMove *move = &frame->moves[frame->next - 1];
+    ctx->free_in[move->idx] = frame->saved;
+
+    if (ctx->aborted) {
+      while (step > root) {
+        frame = &ctx->frames[--step];
+        ctx->free_in[frame->moves[frame->next - 1].idx] = frame->saved;
+      }
+      return 0;
+    }
+
+    int child = move->bonus + value;
+    if (step > 0) {
+      if (child > frame->best)
+        frame->best = child;
+    } else {
+      int score = rootScore(ctx, move->dir, child);
+      if (score > best_score) {
+        best_score = score;
+        frame->best = child;
+        *best_dir = move->dir;
+      }
+    }
+  }
+}
+
+#if AI_SEARCH_WORKERS > 1
+
+/* Symbol: SearchTask
+ *   Sottoalbero della ricerca che inizia con le mosse [first]
+ *   e [second], valutato da uno dei thread di [searchSplit].
+ *   [root] è l'indice di [first] tra le prime mosse.
+ */
+typedef struct {
+  unsigned int root;
+  SearchMove   first;
+  SearchMove   second;
+  int          value;
+} SearchTask;
+
+/* Symbol: SearchPool
+ *   Thread che eseguono i [SearchTask] di una ricerca. Con
+ *   [workers] thread, il thread [w] esegue sempre i task
+ *   w, w + workers, ..., con la propria tabella delle
+ *   trasposizioni e le proprie [free_in] e [frames]. Il
+ *   thread 0 è quello che chiama [searchSplit] ed usa la
+ *   tabella del joystick.
+ *
+ *   I thread sono creati da [SearchJoystick_setWorkers] e
+ *   restano in attesa tra una ricerca e l'altra, perché una
+ *   ricerca dura poche centinaia di microsecondi sull'host.
+ *   [started] conta i thread creati, compreso il thread 0;
+ *   quelli oltre [workers] si svegliano ad ogni ricerca ma
+ *   non eseguono task.
+ */
+static struct {
+  pthread_t       threads[AI_SEARCH_WORKERS];
+  pthread_mutex_t lock;
+  pthread_cond_t  start;
+  pthread_cond_t  done;
+  unsigned int    started;
+  unsigned int    workers;
+  unsigned int    round;
+  unsigned int    pending;
+
+  const SearchContext *ctx;
+  SearchTask          *tasks;
+  unsigned int         task_count;
+
+  TranspositionTable tables[AI_SEARCH_WORKERS];
+  uint16_t           free_in[AI_SEARCH_WORKERS][MAX_BOARD_CELLS];
+  SearchFrame        frames[AI_SEARCH_WORKERS][AI_SEARCH_DEPTH];
+} pool = {
+  .lock    = PTHREAD_MUTEX_INITIALIZER,
+  .start   = PTHREAD_COND_INITIALIZER,
+  .done    = PTHREAD_COND_INITIALIZER,
+  .started = 1,
+  .workers = 1,
+};
+
+static void SearchPool_runTasks(unsigned int worker)
+{
+  SearchContext ctx = *pool.ctx;
+  ctx.free_in = pool.free_in[worker];
+  ctx.frames = pool.frames[worker];
+  if (worker > 0) {
+    ctx.table = &pool.tables[worker];
+    TranspositionTable_newSearch(ctx.table);
+  }
+
+  const int cells = ctx.world->width * ctx.world->height;
+
+  for (unsigned int t = worker; t < pool.task_count; t += pool.workers) {
+    SearchTask *task = &pool.tasks[t];
+
+    memcpy(ctx.free_in, pool.ctx->free_in, cells * sizeof(ctx.free_in[0]));
+    ctx.free_in[task->first.idx]  = 1 + ctx.size;
+    ctx.free_in[task->second.idx] = 2 + ctx.size;
+    ctx.path[1] = task->first.pos;
+    ctx.path[2] = task->second.pos;
+
+    task->value = task->second.bonus + search(&ctx, task->second.pos, task->second.dir, 2,
+                                              task->second.key, task->second.eaten, 0);
+  }
+}
+
+static void *SearchPool_thread(void *arg)
+{
+  unsigned int worker = (uintptr_t) arg;
+  unsigned int seen = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&pool.lock);
+    while (pool.round == seen)
+      pthread_cond_wait(&pool.start, &pool.lock);
+    seen = pool.round;
+    pthread_mutex_unlock(&pool.lock);
+
+    if (worker < pool.workers)
+      SearchPool_runTasks(worker);
+
+    pthread_mutex_lock(&pool.lock);
+    if (--pool.pending == 0)
+      pthread_cond_signal(&pool.done);
+    pthread_mutex_unlock(&pool.lock);
+  }
+  return 0;
+}
+
+static void SearchPool_run(const SearchContext *ctx, SearchTask *tasks, unsigned int count)
+{
+  pthread_mutex_lock(&pool.lock);
+  pool.ctx = ctx;
+  pool.tasks = tasks;
+  pool.task_count = count;
+  pool.pending = pool.started - 1;
+  pool.round++;
+  pthread_cond_broadcast(&pool.start);
+  pthread_mutex_unlock(&pool.lock);
+
+  SearchPool_runTasks(0);
+
+  pthread_mutex_lock(&pool.lock);
+  while (pool.pending > 0)
+    pthread_cond_wait(&pool.done, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+}
+
+/* Symbol: searchSplit
+ *   Come [search] dalla posizione iniziale, ma valuta in
+ *   parallelo i sottoalberi di ogni coppia di prime due
+ *   mosse (al più 9) e ne unisce i valori nell'ordine delle
+ *   direzioni, come farebbero i primi due livelli di
+ *   [search].
+ *
+ *   Ogni task è sempre dello stesso thread ed i valori non
+ *   dipendono dall'ordine in cui i thread finiscono, quindi
+ *   il risultato dipende solo dal seme e dal numero di
+ *   thread. Può differire dalla ricerca sequenziale perché
+ *   ogni thread ha la sua tabella delle trasposizioni e
+ *   perché i primi due livelli non usano la tabella.
+ */
+static int searchSplit(SearchContext *ctx, Position pos, Direction dir,
+                       uint32_t key, Direction *best_dir)
+{
+  SearchMove   roots[3];
+  unsigned int root_count = generateMoves(ctx, pos, dir, 0, key, 0, roots);
+
+  SearchTask   tasks[9];
+  unsigned int task_count = 0;
+
+  for (unsigned int r = 0; r < root_count; ++r) {
+    const SearchMove *root = &roots[r];
+
+    uint16_t saved = ctx->free_in[root->idx];
+    ctx->free_in[root->idx] = 1 + ctx->size;
+    ctx->path[1] = root->pos;
+
+    SearchMove seconds[3];
+    unsigned int second_count = generateMoves(ctx, root->pos, root->dir, 1,
+                                              root->key, root->eaten, seconds);
+    ctx->free_in[root->idx] = saved;
+
+    for (unsigned int i = 0; i < second_count; ++i)
+      tasks[task_count++] = (SearchTask) { .root = r, .first = *root, .second = seconds[i] };
+  }
+
+  SearchPool_run(ctx, tasks, task_count);
+
+  // Senza seconde mosse il serpente sopravvive solo
+  // alla prima, come in [enterFrame].
+  int root_values[3];
+  for (unsigned int r = 0; r < root_count; ++r)
+    root_values[r] = 1 * SURVIVAL_SCORE;
+  for (unsigned int t = 0; t < task_count; ++t)
+    if (tasks[t].value > root_values[tasks[t].root])
+      root_values[tasks[t].root] = tasks[t].value;
+
+  int best = 0;
+  int best_score = 0;
+  for (unsigned int r = 0; r < root_count; ++r) {
+    int child = roots[r].bonus + root_values[r];
+    int score = rootScore(ctx, roots[r].dir, child);
+    if (score > best_score) {
+      best_score = score;
+      best = child;
+      *best_dir = roots[r].dir;
+    }
+  }
+  return best;
+}
+
+#endif /* AI_SEARCH_WORKERS > 1 */
+
+static Button getButton(Joystick *joystick, int player)
+{
+  SearchJoystick *joystick2 = (SearchJoystick*) joystick;
+  Game *game = (Game*) joystick2->game;
+
+  if (joystick2->budget)
+    AIBudget_begin(joystick2->budget, joystick2->budget_bot);
+
+  const WorldModel *world = Game_getWorldModel(game);
+
+  SearchContext ctx = {
+    .world   = world,
+    .table   = joystick2->table,
+    .player  = player,
+    .size    = Game_getPlayerSize(game, player),
+    .apple   = Game_getApplePosition(game),
+    .budget  = joystick2->budget,
+    .bot     = joystick2->budget_bot,
+    .aborted = 0,
+    .free_in = free_in,
+    .frames  = frames,
+  };
+
+  const int cells = world->width * world->height;
+  for (int i = 0; i < cells; ++i)
+    free_in[i] = world->free_in[i];
+
+  TranspositionTable_newSearch(ctx.table);
+
+  computeLeads(&ctx, game);
+
+  Position  head = Game_getPlayerHeadPosition(game, player);
+  Direction dir  = Game_getPlayerDirection(game, player);
+  uint32_t  key  = Game_getHash(game) ^ stepKey(player, 0);
+
+  // Senza budget si cerca direttamente alla
+  // profondità massima.
+  unsigned int depth = ctx.budget ? 1 : AI_SEARCH_DEPTH;
+
+  Direction best_dir = dir;
+  int value = 0;
+  unsigned int completed = 0;
+  for (; depth <= AI_SEARCH_DEPTH; ++depth) {
+    Direction iteration_dir = dir;
+    ctx.depth = depth;
+#if AI_SEARCH_WORKERS > 1
+    int iteration_value = (ctx.budget == 0 && depth >= 2 && pool.workers > 1)
+                        ? searchSplit(&ctx, head, dir, key, &iteration_dir)
+                        : search(&ctx, head, dir, 0, key, 0, &iteration_dir);
+#else
+    int iteration_value = search(&ctx, head, dir, 0, key, 0, &iteration_dir);
+#endif
+    if (ctx.aborted)
+      break;
+    best_dir = iteration_dir;
+    value = iteration_value;
+    completed = depth;
+  }
+
+  joystick2->depth_sum += completed;
+  joystick2->decisions++;
+
+  if (value == 0) {
+    // Tutte le direzioni portano a perdere.
+    Logger_printf("Search player %d is trapped!", player);
+  }
+
+  Direction safe_dir;
+  if (Endgame_findSafeMove(world, player, head, ctx.apple, best_dir,
+                           firstDirections(world, player), &safe_dir))
+    best_dir = safe_dir;
+
+  if (joystick2->budget)
+    AIBudget_end(joystick2->budget, joystick2->budget_bot);
+  return direction_buttons[best_dir];
+}
+
+static JoystickMethodTable table = {
+  .getButton = getButton,
+  .free = 0,
+};
+
+/* Symbol: SearchJoystick_init
+ *   Inizializza il joystick. [transpositions] deve essere stata
+ *   svuotata con [TranspositionTable_clear] e può essere
+ *   condivisa con altri joystick della stessa partita.
+ */
+void SearchJoystick_init(SearchJoystick *ai, void *game, TranspositionTable *transpositions)
+{
+  ai->base.table = &table;
+  ai->game = game;
+  ai->table = transpositions;
+  ai->budget = 0;
+  ai->budget_bot = -1;
+  ai->depth_sum = 0;
+  ai->decisions = 0;
+}
+
+/* Symbol: SearchJoystick_setBudget
+ *   Fa sì che il joystick usi una parte di [budget] ad ogni
+ *   frame, approfondendo la ricerca finché non la esaurisce.
+ *   Ritorna 0 se il budget ha già troppi giocatori.
+ */
+_Bool SearchJoystick_setBudget(SearchJoystick *ai, AIBudget *budget)
+{
+  int bot = AIBudget_register(budget);
+  if (bot < 0)
+    return 0;
+  ai->budget = budget;
+  ai->budget_bot = bot;
+  return 1;
+}
+
+#if AI_SEARCH_WORKERS > 1
+
+/* Symbol: SearchJoystick_setWorkers
+ *   Fa dividere le ricerche senza budget di tutti i joystick
+ *   tra [workers] thread (al massimo AI_SEARCH_WORKERS),
+ *   creando quelli che mancano, e ne ritorna il numero. Se
+ *   un thread non si può creare ne usa meno. Con 1 thread
+ *   (il valore iniziale) la ricerca è quella sequenziale.
+ *
+ *   Le tabelle dei thread sono svuotate, quindi va chiamata
+ *   tra una partita e l'altra.
+ */
+unsigned int SearchJoystick_setWorkers(unsigned int workers)
+{
+  if (workers < 1)
+    workers = 1;
+  if (workers > AI_SEARCH_WORKERS)
+    workers = AI_SEARCH_WORKERS;
+
+  while (pool.started < workers) {
+    unsigned int w = pool.started;
+    if (pthread_create(&pool.threads[w], 0, SearchPool_thread, (void*) (uintptr_t) w) != 0) {
+      Logger_printf("ERROR :: Couldn't create search worker %u", w);
+      break;
+    }
+    pool.started++;
+  }
+
+  pool.workers = (workers < pool.started) ? workers : pool.started;
+  for (unsigned int w = 1; w < pool.workers; ++w)
+    TranspositionTable_clear(&pool.tables[w]);
+  return pool.workers;
+}
+
+#endif /* AI_SEARCH_WORKERS > 1 */
+
+unsigned int SearchJoystick_getDecisions(SearchJoystick *ai)
+{
+  return ai->decisions;
+}
+
+/* Symbol: SearchJoystick_getDepthSum
+ *   Ritorna la somma delle profondità completate dalla
+ *   ricerca, da dividere per [SearchJoystick_getDecisions].
+ */
+unsigned int SearchJoystick_getDepthSum(SearchJoystick *ai)
+{
+  return ai->depth_sum;
+}
+
+/* Symbol: SearchJoystick_getOverruns
+ *   Ritorna il numero di decisioni che hanno superato la
+ *   parte del budget del joystick (0 se non ha un budget).
+ */
+unsigned int SearchJoystick_getOverruns(SearchJoystick *ai)
+{
+  if (ai->budget == 0)
+    return 0;
+  return AIBudget_getOverruns(ai->budget, ai->budget_bot);
+}
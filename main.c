@@ -6,8 +6,12 @@
 #include "logger.h"
 #include "display.h"
 #include "console.h"
+#include "tournament.h"
 #include "chprintf.h"
 
+// Nessun messaggio stampa numeri in virgola mobile, e
+// senza il loro supporto stbsp_snprintf usa molto meno stack.
+#define STB_SPRINTF_NOFLOAT
 #define STB_SPRINTF_IMPLEMENTATION
 #include "stb_sprintf.h"
 
@@ -28,6 +32,23 @@ int main(void)
   PhysicalJoystick *physical_joystick_1 = Console_getPhysicalJoystick(1);
 
   Display_changeResolution(x_res, y_res);
+
+#ifdef TOURNAMENT_MODE
+  {
+    // I risultati sono sulla seriale; se una baseline non
+    //  rispettata il sistema si ferma, cos che il
+    // fallimento si veda anche dal debugger.
+    _Bool passed = Tournament_run();
+    Display_clear(0);
+    Display_drawText(passed ? "TOURNAMENT PASSED" : "TOURNAMENT FAILED", 4, 27, 0);
+    Display_update();
+    if (!passed) {
+      Display_waitIdle();
+      chSysHalt("tournament failed");
+    }
+    goto loop;
+  }
+#endif
   PhysicalJoystick_setSensitivity(physical_joystick_0, SENSITIVITY_MEDIUM);
   PhysicalJoystick_setSensitivity(physical_joystick_1, SENSITIVITY_MEDIUM);
 
@@ -41,11 +62,20 @@ int main(void)
   RandomJoystick random_joystick_2;
   AIJoystick ai_joystick_1;
   AIJoystick ai_joystick_2;
+#ifdef CLASSIC_AI_PLAYER
+  HamiltonJoystick hamilton_joystick;
+#endif
+  _Bool ai_players = 0;
 
   switch (menu((Joystick*) physical_joystick_0)) {
   case MenuOption_CLASSIC:
     {
+#ifdef CLASSIC_AI_PLAYER
+      HamiltonJoystick_init(&hamilton_joystick, game);
+      Game_plugJoystick(game, (Joystick*) &hamilton_joystick);
+#else
       Game_plugJoystick(game, (Joystick*) physical_joystick_0);
+#endif
       break;
     }
 
@@ -58,10 +88,11 @@ int main(void)
 
   case MenuOption_ROYALE:
     {
-      RandomJoystick_init2(&random_joystick_1, 69420);
-      RandomJoystick_init2(&random_joystick_2, 10000);
-      AIJoystick_init(&ai_joystick_1, game);
-      AIJoystick_init(&ai_joystick_2, game);
+      RandomJoystick_initSafe(&random_joystick_1, game, 69420);
+      RandomJoystick_initSafe(&random_joystick_2, game, 10000);
+      AIJoystick_initAsync(&ai_joystick_1, game);
+      AIJoystick_initAsync(&ai_joystick_2, game);
+      ai_players = 1;
       Game_plugJoystick(game, (Joystick*) physical_joystick_0);
       Game_plugJoystick(game, (Joystick*) &random_joystick_1);
       Game_plugJoystick(game, (Joystick*) &random_joystick_2);
@@ -73,6 +104,14 @@ int main(void)
 
   GameEvent event = Game_play(game);
 
+  if (ai_players) {
+    Logger_printf("AI deadlines missed: %d, %d",
+                  AIJoystick_getMissedDeadlines(&ai_joystick_1),
+                  AIJoystick_getMissedDeadlines(&ai_joystick_2));
+    Joystick_free((Joystick*) &ai_joystick_1);
+    Joystick_free((Joystick*) &ai_joystick_2);
+  }
+
   Display_clear(0);
   switch (event.type) {
 
@@ -89,6 +128,7 @@ int main(void)
     break;
 
   case GameEventType_NOEVENT:
+  case GameEventType_DRAW:
   case GameEventType_ERROR:
     Logger_printf(" avvenuto un errore durante il gioco");
     break;
@@ -0,0 +1,27 @@
+/* Generato da tools/train_policy.py (seed 1, 40 generazioni).
+ * Non modificare a mano: rigenerare con lo script.
+ */
+#include "policy_weights.h"
+
+const int8_t policy_w1[POLICY_HIDDEN][POLICY_INPUTS] = {
+  {   73,   53,  -27,   47,  -57,   33,   43,  -20,    5,    1,    7,   61,   12,   80,  -58,  -13,    1,   15,  -38,   -6,   50,  -33,  -26,  -21,   68,  -18,    3,   38 },
+  {   -2,  -63,    1,  -66,   30,  -39,   14,   24,   12,  -31,   64,  -30,  -10,  -22,   36,   59,  -34,  -30,  -49,  -29,   68,  -23,   25,   -9,  -26,  -62,   54,   37 },
+  {  -63,   12,  -44,   56,   32,  -46,  -43,   -4,  -16,   81,   15,   -4,  -43,   11,    6,   -7,   29,   -9,    8,  -47,   -8,  -46,  -26,    0,   35,   -5,   26,   -3 },
+  {  -63,   -8,   15,  -85,    2,   34,   15,   26,   -9,  -41,  -10,  -32,   40, -127,  -65,   32,  -43,  -27,  -45,    5,   16,  -25,   47,  -63,   -2,  -43,   20,   61 },
+  {   72,  -28,  -28,   -1,    2,   -8,  -62,   23,  -90,  -28,  -43,  -37,    0,   -7,  -27,  -48,  -38,  -83,  -34,  -27,   43,  -18,   69,   40,  -20,   10,  -22,    7 },
+  {    1,   22,  -27,  -47,   45,   22,   44,  -51,   36,  -20,  -20,  -30,   14,   67,  -27,  -16,  -21,   14,   36,   64,  -36,  -17,   80,   26,  -53,   32,   29,   26 },
+  {   28,  -14,   19,  -34,   26,  -12,   14,   35,   -4,  -20,   57,   38,  -20,   21,   22,  -20,   -8,   -5,   27,  -41,   -8,   40,  -22,  -83,   26,  -64,   34,  -23 },
+  {   -4,   81,  -82,  -44,  -27,  -38,  -14,   72,   -6,    7,    8,  -30,   -9,   13,   24,  -15,   -2,   33,   26,  -40,  -22,    0,   40,   31,    3,   20,    2,  -34 }
+};
+
+const int32_t policy_b1[POLICY_HIDDEN] = { 663, 5423, -3604, 3167, -138, 2146, -2631, 486 };
+
+const int8_t policy_w2[POLICY_OUTPUTS][POLICY_HIDDEN] = {
+  {   38, -127,  -11,   -2,   20,   65,   38,  -72 },
+  {   13,  -89,   41,    2,    9,   62,  -12,  -34 },
+  {   37,   76,   14,  108,  -83,  -12,  -19,    7 }
+};
+
+const int32_t policy_b2[POLICY_OUTPUTS] = { 1179, 2584, -634 };
+
+const unsigned int policy_hidden_shift = 7;
@@ -0,0 +1,33 @@
+#ifndef POLICY_WEIGHTS_H
+#define POLICY_WEIGHTS_H
+
+#include <stdint.h>
+
+/* Symbol: policy_w1, policy_b1, policy_w2, policy_b2, policy_hidden_shift
+ *   Pesi quantizzati della rete di [PolicyJoystick], generati
+ *   da tools/train_policy.py in policy_weights.c. Le dimensioni
+ *   devono coincidere con quelle dello script.
+ *
+ *   I pesi sono int8 e le somme sono accumulate su int32. Dopo
+ *   la ReLU i valori nascosti sono riportati ad int8 con uno
+ *   shift a destra di [policy_hidden_shift] bit.
+ *
+ * Nota: POLICY_INPUTS e POLICY_HIDDEN sono multipli di 4 così
+ *       che i prodotti scalari si possano fare 4 byte alla
+ *       volta (vedi [dotInt8] in joystick_policy.c).
+ */
+#define POLICY_WINDOW  2
+#define POLICY_INPUTS  28
+#define POLICY_HIDDEN  8
+#define POLICY_OUTPUTS 3
+
+// Valore intero di un ingresso uguale ad 1.
+#define POLICY_INPUT_ONE 64
+
+extern const int8_t  policy_w1[POLICY_HIDDEN][POLICY_INPUTS];
+extern const int32_t policy_b1[POLICY_HIDDEN];
+extern const int8_t  policy_w2[POLICY_OUTPUTS][POLICY_HIDDEN];
+extern const int32_t policy_b2[POLICY_OUTPUTS];
+extern const unsigned int policy_hidden_shift;
+
+#endif /* POLICY_WEIGHTS_H */
@@ -8,7 +8,7 @@
  *   rappresentare il corpo di un serpente.
  */
 typedef struct {
-  Direction data[MAX_SNAKE_LEN];
+  unsigned char data[MAX_SNAKE_LEN]; // Valori di tipo [Direction]
   unsigned int size, head;
 } DirectionQueue;
 
@@ -44,9 +44,17 @@ typedef struct {
  */
 struct Snake {
   Position head;
+  Position tail; // Posizione dell'ultimo blocco, aggiornata
+                 // da [Snake_step] per non dover scorrere
+                 // tutto il corpo.
   Direction dir;
   DirectionQueue body;
   _Bool grow;
+
+  // Hash di Zobrist del serpente (vedi [Snake_getHash])
+  // e indice del giocatore usato per calcolarlo.
+  unsigned int owner;
+  uint32_t hash;
 };
 
 /* Symbol: SnakeSlot
@@ -107,17 +115,51 @@ static unsigned int DirectionQueue_size(DirectionQueue *queue)
 
 static Direction DirectionQueue_top(DirectionQueue *queue, unsigned int top)
 {
-  int i = (queue->head-1 - top) % MAX_SNAKE_LEN;
+  unsigned int i = (queue->head + MAX_SNAKE_LEN - 1 - top) % MAX_SNAKE_LEN;
   return queue->data[i];
 }
 
+/* Symbol: directionKey
+ *   Chiave di Zobrist della direzione del serpente. La
+ *   direzione non ha una cella, quindi  usata come
+ *   coordinata x.
+ */
+static uint32_t directionKey(Snake *snake)
+{
+  return zobristKey(ZobristPiece_DIRECTION, snake->owner,
+                    (Position) { .x = snake->dir, .y = 0 });
+}
+
+/* Symbol: Snake_computeHash
+ *   Calcola da zero l'hash del serpente scorrendone
+ *   tutto il corpo. Durante la partita l'hash  invece
+ *   aggiornato ad ogni passo (vedi [Snake_step]).
+ */
+static uint32_t Snake_computeHash(Snake *snake)
+{
+  uint32_t hash = directionKey(snake)
+                ^ zobristKey(ZobristPiece_HEAD, snake->owner, snake->head);
+  if (snake->grow)
+    hash ^= zobristKey(ZobristPiece_GROW, snake->owner, newPosition(0, 0));
+
+  SnakeIter iter = SnakeIter_new(snake);
+  do
+    hash ^= zobristKey(ZobristPiece_BODY, snake->owner, iter.pos);
+  while (SnakeIter_next(&iter));
+  return hash;
+}
+
 static void Snake_init(Snake *snake, int start_x, int start_y)
 {
   snake->head = newPosition(start_x, start_y);
+  snake->tail = snake->head;
   snake->dir = DIR_LEFT;
   snake->grow = 0;
 
   DirectionQueue_init(&snake->body);
+
+  snake->owner = 0;
+  snake->hash = Snake_computeHash(snake);
 }
 
 /* Symbol: Snake_new
@@ -153,14 +195,14 @@ Snake *Snake_new(int start_x, int start_y)
 
 /* Symbol: Snake_new2
  *   Instanzia un serpente e posizionalo in
- *   una posizione randomica. Se il limite
- *   di sistema dei serpenti allocati  stato
- *   raggiunto, NULL  ritornato.
+ *   una posizione randomica generata da [rng].
+ *   Se il limite di sistema dei serpenti
+ *   allocati  stato raggiunto, NULL  ritornato.
  */
-Snake *Snake_new2(void)
+Snake *Snake_new2(Rng *rng)
 {
-  return Snake_new(generateRandomInteger(),
-                   generateRandomInteger());
+  Position pos = Rng_position(rng);
+  return Snake_new(pos.x, pos.y);
 }
 
 void Snake_free(Snake *snake)
@@ -182,7 +224,9 @@ void Snake_changeDirection(Snake *snake, Direction new_dir)
   if (new_dir == oppositeDirection(snake->dir)) {
     Logger_printf("Snakes can't go backwards");
   } else {
+    snake->hash ^= directionKey(snake);
     snake->dir = new_dir;
+    snake->hash ^= directionKey(snake);
   }
 }
 
@@ -192,14 +236,48 @@ void Snake_changeDirection(Snake *snake, Direction new_dir)
  */
 void Snake_step(Snake *snake)
 {
-  DirectionQueue_push(&snake->body, oppositeDirection(snake->dir));
-  snake->head = evaluateNextPosition(snake->head, snake->dir);
+  unsigned int size = DirectionQueue_size(&snake->body);
+
+  // Un serpente lungo MAX_SNAKE_LEN non pu pi crescere.
+  _Bool grow = snake->grow && size < MAX_SNAKE_LEN;
+  if (snake->grow)
+    snake->hash ^= zobristKey(ZobristPiece_GROW, snake->owner, newPosition(0, 0));
+  snake->grow = 0;
+
+  Position new_head = evaluateNextPosition(snake->head, snake->dir);
+
+  // Aggiorna l'hash: la testa si sposta, si aggiunge un
+  // blocco in [new_head] e, se il serpente non cresce, si
+  // toglie quello della coda. Costa O(1) indipendentemente
+  // dalla lunghezza del serpente.
+  snake->hash ^= zobristKey(ZobristPiece_HEAD, snake->owner, snake->head)
+               ^ zobristKey(ZobristPiece_HEAD, snake->owner, new_head)
+               ^ zobristKey(ZobristPiece_BODY, snake->owner, new_head);
+  if (!grow)
+    snake->hash ^= zobristKey(ZobristPiece_BODY, snake->owner, snake->tail);
+
+  if (!grow) {
 
-  if (!snake->grow) {
+    if (size == 0) {
+      // Il serpente  fatto solo dalla testa.
+      snake->head = new_head;
+      snake->tail = new_head;
+      return;
+    }
+
+    // La coda avanza verso il penultimo blocco. La
+    // direzione pi vecchia della coda  quella che
+    // va dal penultimo blocco alla coda.
+    Direction last = DirectionQueue_top(&snake->body, size-1);
+    snake->tail = evaluateNextPosition(snake->tail, oppositeDirection(last));
+
+    // Rimuovendo prima di inserire la coda non si
+    // riempie mai oltre MAX_SNAKE_LEN.
     DirectionQueue_pop(&snake->body);
-  } else {
-    snake->grow = 0;
   }
+
+  DirectionQueue_push(&snake->body, oppositeDirection(snake->dir));
+  snake->head = new_head;
 }
 
 /* Symbol: Snake_grow
@@ -209,9 +287,34 @@ void Snake_step(Snake *snake)
  */
 void Snake_grow(Snake *snake)
 {
+  if (!snake->grow)
+    snake->hash ^= zobristKey(ZobristPiece_GROW, snake->owner, newPosition(0, 0));
   snake->grow = 1;
 }
 
+/* Symbol: Snake_setOwner
+ *   Imposta l'indice del giocatore a cui appartiene il
+ *   serpente. L'indice entra nell'hash (vedi [Snake_getHash]),
+ *   cos che due serpenti di giocatori diversi nella stessa
+ *   posizione non abbiano lo stesso hash.
+ */
+void Snake_setOwner(Snake *snake, unsigned int owner)
+{
+  snake->owner = owner;
+  snake->hash = Snake_computeHash(snake);
+}
+
+/* Symbol: Snake_getHash
+ *   Ritorna l'hash di Zobrist del serpente, cio lo XOR
+ *   delle chiavi (vedi [zobristKey]) della testa, di ogni
+ *   blocco del corpo, della direzione e della crescita in
+ *   sospeso.
+ */
+uint32_t Snake_getHash(Snake *snake)
+{
+  return snake->hash;
+}
+
 /* Symbol: Snake_occupiesPosition
  *   Ritorna 1 se almeno una parte del serpente [snake] 
  *   occupa la posizione data [pos], 0 altrimenti.
@@ -247,11 +350,25 @@ Position Snake_getHeadPosition(Snake *snake)
   return snake->head;
 }
 
+Position Snake_getTailPosition(Snake *snake)
+{
+  return snake->tail;
+}
+
 Direction Snake_getDirection(Snake *snake)
 {
   return snake->dir;
 }
 
+/* Symbol: Snake_willGrow
+ *   Ritorna 1 se al prossimo [Snake_step] il serpente
+ *   crescer (cio la sua coda non si sposter).
+ */
+_Bool Snake_willGrow(Snake *snake)
+{
+  return snake->grow;
+}
+
 unsigned int Snake_getSize(Snake *snake)
 {
   return 1 + DirectionQueue_size(&snake->body);
@@ -2,18 +2,22 @@
 
 typedef struct Snake Snake;
 Snake   *Snake_new(int start_x, int start_y);
-Snake   *Snake_new2(void);
+Snake   *Snake_new2(Rng *rng);
 void     Snake_step(Snake *snake);
 void     Snake_grow(Snake *snake);
 void     Snake_free(Snake *snake);
 unsigned int Snake_getSize(Snake *snake);
 Position Snake_getHeadPosition(Snake *snake);
+Position Snake_getTailPosition(Snake *snake);
 void     Snake_changeDirection(Snake *snake, Direction new_dir);
 _Bool    Snake_occupiesPosition(Snake *snake, Position pos);
 _Bool    Snake_getBodyPosition(Snake *snake, unsigned int n, Position *pos);
 _Bool    Snake_occupiesPosition(Snake *snake, Position pos);
 _Bool    Snake_bodyOccupiesPosition(Snake *snake, Position pos);
 Direction Snake_getDirection(Snake *snake);
+_Bool    Snake_willGrow(Snake *snake);
+void     Snake_setOwner(Snake *snake, unsigned int owner);
+uint32_t Snake_getHash(Snake *snake);
 
 typedef struct {
   Snake *snake; // const?
@@ -10,78 +10,352 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
-static msg_t wrCmd(void *ip, uint8_t cmd) {
-  const SSD1306Driver *drvp = (const SSD1306Driver *)ip;
-  msg_t ret;
-  uint8_t txbuf[] = { 0x00, cmd };
+#if SSD1306_USE_PANEL_MODEL
+/*
+ * Number of argument bytes following each command the driver sends.
+ */
+static uint8_t panelArgs(uint8_t cmd) {
+  switch (cmd) {
+  case 0x21: case 0x22:
+    return 2;
+  case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+  case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+    return 1;
+  default:
+    return 0;
+  }
+}
 
-  i2cAcquireBus(drvp->config->i2cp);
-  i2cStart(drvp->config->i2cp, drvp->config->i2ccfg);
+static void panelCmd(ssd1306_panel_t *pnl, uint8_t byte) {
+  if (pnl->args > 0) {
+    // Argument of the pending command
+    pnl->args--;
+    switch (pnl->cmd) {
+    case 0x20:
+      pnl->mode = byte & 0x03;
+      break;
+    case 0x21:
+      if (pnl->args == 1) pnl->col_start = pnl->col = byte & 0x7F;
+      else                pnl->col_end = byte & 0x7F;
+      break;
+    case 0x22:
+      if (pnl->args == 1) pnl->page_start = pnl->page = byte & 0x07;
+      else                pnl->page_end = byte & 0x07;
+      break;
+    }
+    return;
+  }
 
-  ret = i2cMasterTransmitTimeout(drvp->config->i2cp, drvp->config->sad,
-                                 txbuf, sizeof(txbuf), NULL, 0, TIME_INFINITE);
+  pnl->cmd = byte;
+  pnl->args = panelArgs(byte);
 
-  i2cReleaseBus(drvp->config->i2cp);
+  if (pnl->mode == 0x02) {
+    if (byte <= 0x0F) {
+      pnl->col = (pnl->col & 0xF0) | byte;
+    } else if (byte <= 0x1F) {
+      pnl->col = ((byte & 0x07) << 4) | (pnl->col & 0x0F);
+    } else if (byte >= 0xB0 && byte <= 0xB7) {
+      pnl->page = byte & 0x07;
+    }
+  }
+}
 
-  return ret;
+static void panelDat(ssd1306_panel_t *pnl, uint8_t byte) {
+  pnl->ram[pnl->page][pnl->col] = byte;
+
+  if (pnl->mode == 0x02) {
+    pnl->col = (pnl->col + 1) & 0x7F;
+  } else if (pnl->col++ == pnl->col_end) {
+    pnl->col = pnl->col_start;
+    pnl->page = (pnl->page == pnl->page_end) ? pnl->page_start : pnl->page + 1;
+  }
 }
 
-static msg_t wrDat(void *ip, uint8_t *txbuf, uint16_t len) {
-  const SSD1306Driver *drvp = (const SSD1306Driver *)ip;
-  msg_t ret;
+/*
+ * Decodes an I2C transaction the way the controller does: each control
+ * byte says whether the next bytes are commands or data (D/C#, bit 6) and
+ * whether another control byte follows after one of them (Co, bit 7).
+ */
+static void panelFeed(ssd1306_panel_t *pnl, const uint8_t *txbuf, size_t len) {
+  size_t idx = 0;
+
+  while (idx < len) {
+    uint8_t ctrl = txbuf[idx++];
+    size_t n = (ctrl & 0x80) ? 1 : len - idx;
+
+    for (; n > 0 && idx < len; n--, idx++) {
+      if (ctrl & 0x40) panelDat(pnl, txbuf[idx]);
+      else             panelCmd(pnl, txbuf[idx]);
+    }
+  }
+}
+#endif
 
+/*
+ * The bus is acquired and the I2C peripheral started once per update,
+ * all the transactions of a frame are sent in between.
+ */
+static void busAcquire(SSD1306Driver *drvp) {
   i2cAcquireBus(drvp->config->i2cp);
   i2cStart(drvp->config->i2cp, drvp->config->i2ccfg);
+}
 
+static void busRelease(SSD1306Driver *drvp) {
+  i2cReleaseBus(drvp->config->i2cp);
+}
+
+static msg_t wrI2c(SSD1306Driver *drvp, const uint8_t *txbuf, size_t len) {
+  msg_t ret;
+
+#if SSD1306_SIMULATED_BUS_HZ
+  // Address byte and data bytes, 9 clocks each with the ACK
+  chThdSleepMicroseconds((uint32_t)(len + 1) * 9 * 1000 / (SSD1306_SIMULATED_BUS_HZ / 1000));
+  ret = MSG_OK;
+#else
   ret = i2cMasterTransmitTimeout(drvp->config->i2cp, drvp->config->sad,
                                  txbuf, len, NULL, 0, TIME_INFINITE);
+#endif
+  drvp->bytes += len;
+  drvp->transfers++;
+#if SSD1306_USE_PANEL_MODEL
+  panelFeed(&drvp->panel, txbuf, len);
+#endif
 
-  i2cReleaseBus(drvp->config->i2cp);
+  return ret;
+}
+
+/*
+ * Sends a list of commands in a single transaction: a 0x00 control byte
+ * (Co = 0, D/C# = 0) makes the controller read every following byte as
+ * a command.
+ */
+#define SSD1306_CMDS_MAX 32
+
+static msg_t wrCmds(void *ip, const uint8_t *cmds, uint8_t n) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  uint8_t txbuf[SSD1306_CMDS_MAX + 1];
+  msg_t ret;
+
+  chDbgCheck(n <= SSD1306_CMDS_MAX);
+
+  txbuf[0] = 0x00;
+  memcpy(&txbuf[1], cmds, n);
+
+  busAcquire(drvp);
+  ret = wrI2c(drvp, txbuf, n + 1);
+  busRelease(drvp);
 
   return ret;
 }
 
-static void updateScreen(void *ip) {
+static inline void markDirty(SSD1306Driver *drvp, uint8_t page, uint8_t x0, uint8_t x1) {
+  if (x0 < drvp->dirty_x0[page]) drvp->dirty_x0[page] = x0;
+  if (x1 > drvp->dirty_x1[page]) drvp->dirty_x1[page] = x1;
+}
+
+static void markAllDirty(SSD1306Driver *drvp) {
+  memset(drvp->dirty_x0, 0, sizeof(drvp->dirty_x0));
+  memset(drvp->dirty_x1, SSD1306_WIDTH - 1, sizeof(drvp->dirty_x1));
+}
+
+/*
+ * The framebuffers and the shadow start on a word boundary and hold no
+ * control bytes, so the operations over the whole frame go a 32-bit word
+ * at a time instead of a byte at a time. There is no explicit SIMD path:
+ * the Cortex-M4 has none, and on the host GCC vectorises these loops at
+ * -O2 (check with -fopt-info-vec).
+ */
+typedef uint32_t ssd1306_u32_t __attribute__((may_alias));
+
+#define SSD1306_FB_WORDS    (SSD1306_FB_SIZE / sizeof(ssd1306_u32_t))
+
+/*
+ * Commands sent in front of a full frame: horizontal addressing mode over
+ * the whole display RAM, each byte after a continuation control byte, and
+ * the control byte of the data that follows.
+ */
+static const uint8_t full_header[] = {
+  0x80, 0x20, 0x80, 0x00,                       // Horizontal addressing mode
+  0x80, 0x21, 0x80, 0x00, 0x80, SSD1306_WIDTH - 1,  // Columns 0 ~ 127
+  0x80, 0x22, 0x80, 0x00, 0x80, SSD1306_PAGES - 1,  // Pages 0 ~ 7
+  0x40,
+};
+
+/*
+ * Streams the whole front buffer in a single transaction, which the I2C
+ * driver moves with DMA.
+ */
+static void updateFull(SSD1306Driver *drvp) {
+  uint8_t *txbuf = drvp->front - sizeof(full_header);
+
+  chDbgAssert(sizeof(full_header) <= SSD1306_FB_HEADER, "updateFull(), header too long");
+  memcpy(txbuf, full_header, sizeof(full_header));
+
+  busAcquire(drvp);
+  wrI2c(drvp, txbuf, sizeof(full_header) + SSD1306_FB_SIZE);
+  busRelease(drvp);
+
+  memcpy(drvp->shadow, drvp->front, SSD1306_FB_SIZE);
+  drvp->shadow_valid = true;
+  drvp->hmode = true;
+}
+
+/*
+ * Makes the back buffer the frame to transmit. Drawing goes on in the
+ * other buffer, which starts as a copy of the swapped frame.
+ */
+static void swapBuffers(void *ip) {
   SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  uint8_t *back = drvp->front;
   uint8_t idx;
 
-  for (idx = 0; idx < 8; idx++) {
-    wrCmd(drvp, 0xB0 + idx);
-    wrCmd(drvp, 0x00);
-    wrCmd(drvp, 0x10);
+  for (idx = 0; idx < SSD1306_PAGES; idx++) {
+    if (drvp->dirty_x0[idx] < drvp->flush_x0[idx]) drvp->flush_x0[idx] = drvp->dirty_x0[idx];
+    if (drvp->dirty_x1[idx] > drvp->flush_x1[idx]) drvp->flush_x1[idx] = drvp->dirty_x1[idx];
+  }
+  memset(drvp->dirty_x0, 0xFF, sizeof(drvp->dirty_x0));
+  memset(drvp->dirty_x1, 0, sizeof(drvp->dirty_x1));
+
+  drvp->front = drvp->fb;
+  drvp->fb = back;
+  memcpy(drvp->fb, drvp->front, SSD1306_FB_SIZE);
+}
+
+/*
+ * Transmits the front buffer. Only the columns that differ from the shadow
+ * copy of the panel RAM are sent, one transaction per run of changed
+ * columns. Runs closer than SSD1306_RUN_GAP columns are merged, since
+ * the bytes in between cost less than the header of another transaction.
+ */
+#define SSD1306_RUNS_MAX    32
+#define SSD1306_RUN_GAP     8
+
+static void flushScreen(void *ip) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  struct { uint8_t page, x0, x1; } runs[SSD1306_RUNS_MAX];
+  uint8_t txbuf[11 + SSD1306_WIDTH];
+  uint8_t idx, x, x0, x1, last, len, n = 0;
+  uint16_t cost = 0;
+  bool full = !drvp->shadow_valid;
+
+  for (idx = 0; idx < SSD1306_PAGES && !full; idx++) {
+    const uint8_t *fr = &drvp->front[SSD1306_WIDTH * idx];
+    const uint8_t *sh = &drvp->shadow[SSD1306_WIDTH * idx];
+
+    for (x = drvp->flush_x0[idx]; x <= drvp->flush_x1[idx] && x < SSD1306_WIDTH; x++) {
+      // Unchanged aligned words are skipped 4 columns at a time
+      if ((x & 3) == 0 && x + 3 <= drvp->flush_x1[idx] &&
+          *(const ssd1306_u32_t *)&fr[x] == *(const ssd1306_u32_t *)&sh[x]) {
+        x += 3;
+        continue;
+      }
+      if (fr[x] == sh[x]) continue;
+
+      x0 = last = x;
+      for (x++; x <= drvp->flush_x1[idx]; x++) {
+        if (fr[x] != sh[x]) last = x;
+        else if (x - last > SSD1306_RUN_GAP) break;
+      }
+
+      if (n == SSD1306_RUNS_MAX) {
+        full = true;
+        break;
+      }
+      runs[n].page = idx;
+      runs[n].x0 = x0;
+      runs[n].x1 = last;
+      n++;
+      cost += last - x0 + 8;
+    }
+  }
+
+  memset(drvp->flush_x0, 0xFF, sizeof(drvp->flush_x0));
+  memset(drvp->flush_x1, 0, sizeof(drvp->flush_x1));
+
+  // If the runs cost as much as the full frame stream everything in one go
+  if (full || cost >= sizeof(full_header) + SSD1306_FB_SIZE) {
+    updateFull(drvp);
+    return;
+  }
+  if (n == 0) {
+    return;
+  }
 
-    // Write multi data
-    wrDat(drvp, &drvp->fb[SSD1306_WIDTH_FIXED * idx], SSD1306_WIDTH_FIXED);
+  busAcquire(drvp);
+
+  for (idx = 0; idx < n; idx++) {
+    x0 = runs[idx].x0;
+    x1 = runs[idx].x1;
+
+    // One transaction per run: the addressing commands, each after a
+    // continuation control byte (Co = 1), then the run as data
+    len = 0;
+    if (drvp->hmode) {
+      // Back to page addressing mode after a full update
+      txbuf[len++] = 0x80;
+      txbuf[len++] = 0x20;
+      txbuf[len++] = 0x80;
+      txbuf[len++] = 0x02;
+      drvp->hmode = false;
+    }
+    txbuf[len++] = 0x80;
+    txbuf[len++] = 0xB0 + runs[idx].page;
+    txbuf[len++] = 0x80;
+    txbuf[len++] = 0x00 | (x0 & 0x0F);
+    txbuf[len++] = 0x80;
+    txbuf[len++] = 0x10 | (x0 >> 4);
+    txbuf[len++] = 0x40;
+    memcpy(&txbuf[len], &drvp->front[SSD1306_WIDTH * runs[idx].page + x0], x1 - x0 + 1);
+    wrI2c(drvp, txbuf, len + x1 - x0 + 1);
+
+    memcpy(&drvp->shadow[SSD1306_WIDTH * runs[idx].page + x0], &txbuf[len], x1 - x0 + 1);
   }
+
+  busRelease(drvp);
+}
+
+static void updateScreen(void *ip) {
+  swapBuffers(ip);
+  flushScreen(ip);
 }
 
 static void toggleInvert(void *ip) {
   SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  ssd1306_u32_t *fb = (ssd1306_u32_t *)drvp->fb;
   uint16_t idx;
 
   // Toggle invert
   drvp->inv = !drvp->inv;
 
-  for (idx = 0; idx < sizeof(drvp->fb); idx++) {
-    if (idx % SSD1306_WIDTH_FIXED == 0) continue;
-    drvp->fb[idx] = ~drvp->fb[idx];
+  for (idx = 0; idx < SSD1306_FB_WORDS; idx++) {
+    fb[idx] = ~fb[idx];
   }
+
+  markAllDirty(drvp);
 }
 
 static void fillScreen(void *ip, ssd1306_color_t color) {
   SSD1306Driver *drvp = (SSD1306Driver *)ip;
-  uint8_t idx;
+  ssd1306_u32_t *fb = (ssd1306_u32_t *)drvp->fb;
+  uint32_t fill = 0;
+  uint16_t idx;
 
-  for (idx = 0; idx < 8; idx++) {
-    drvp->fb[SSD1306_WIDTH_FIXED * idx] = 0x40;
-    memset(&drvp->fb[SSD1306_WIDTH_FIXED * idx + 1],
-           color == SSD1306_COLOR_BLACK ? 0x00 : 0xff, SSD1306_WIDTH);
+  if (color == SSD1306_COLOR_WHITE) {
+    fill = ~fill;
   }
+
+  for (idx = 0; idx < SSD1306_FB_WORDS; idx++) {
+    fb[idx] = fill;
+  }
+
+  // The flush only sends what differs from the panel
+  markAllDirty(drvp);
 }
 
 static void drawPixel(void *ip, uint8_t x, uint8_t y, ssd1306_color_t color) {
   SSD1306Driver *drvp = (SSD1306Driver *)ip;
-  if (x > SSD1306_WIDTH || y > SSD1306_HEIGHT) return;
+  uint8_t *byte, old;
+  if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT) return;
 
   // Check if pixels are inverted
   if (drvp->inv) {
@@ -89,10 +363,109 @@ static void drawPixel(void *ip, uint8_t x, uint8_t y, ssd1306_color_t color) {
   }
 
   // Set color
+  byte = &drvp->fb[x + (y / 8) * SSD1306_WIDTH];
+  old = *byte;
   if (color == SSD1306_COLOR_WHITE) {
-    drvp->fb[x + (y / 8) * SSD1306_WIDTH_FIXED + 1] |= 1 << (y % 8);
+    *byte |= 1 << (y % 8);
   } else {
-    drvp->fb[x + (y / 8) * SSD1306_WIDTH_FIXED + 1] &= ~(1 << (y % 8));
+    *byte &= ~(1 << (y % 8));
+  }
+
+  // Mark the column only if the pixel really changed
+  if (*byte != old) {
+    markDirty(drvp, y / 8, x, x);
+  }
+}
+
+/*
+ * Fills w x h pixels from (x, y). A page byte holds 8 rows of a column, so
+ * each column costs one masked write per page the rectangle crosses.
+ */
+static void fillRect(void *ip, uint8_t x, uint8_t y, uint8_t w, uint8_t h, ssd1306_color_t color) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  uint8_t x1, y1, page, mask, col;
+  uint8_t *row;
+
+  if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT || w == 0 || h == 0) return;
+
+  // Clip to the display, x1 and y1 are inclusive
+  x1 = (x + w > SSD1306_WIDTH) ? SSD1306_WIDTH - 1 : x + w - 1;
+  y1 = (y + h > SSD1306_HEIGHT) ? SSD1306_HEIGHT - 1 : y + h - 1;
+
+  // Check if pixels are inverted
+  if (drvp->inv) {
+    color = (ssd1306_color_t)!color;
+  }
+
+  for (page = y / 8; page <= y1 / 8; page++) {
+    // Rows of this page inside the rectangle
+    mask = 0xFF;
+    if (page == y / 8) mask &= 0xFF << (y % 8);
+    if (page == y1 / 8) mask &= 0xFF >> (7 - y1 % 8);
+
+    row = &drvp->fb[SSD1306_WIDTH * page];
+    if (color == SSD1306_COLOR_WHITE) {
+      for (col = x; col <= x1; col++) row[col] |= mask;
+    } else {
+      for (col = x; col <= x1; col++) row[col] &= ~mask;
+    }
+
+    markDirty(drvp, page, x, x1);
+  }
+}
+
+/*
+ * Copies a w x h image stored in pages like the framebuffer (one byte per
+ * column, LSB on top) to (x, y), replacing the pixels under it. Set bits
+ * take the given color, clear bits the other one. If y is not a multiple
+ * of 8 each source byte is split in two shifted halves over two pages.
+ */
+static void blit(void *ip, const uint8_t *img, uint8_t w, uint8_t h,
+                 uint8_t x, uint8_t y, ssd1306_color_t color) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  const uint8_t shift = y % 8;
+  uint8_t pages, cols, page, dst, mask, col, b;
+  uint8_t *row;
+  bool invert;
+
+  if (x >= SSD1306_WIDTH || y >= SSD1306_HEIGHT || w == 0 || h == 0) return;
+
+  // Clip the columns, the pages are clipped one by one
+  cols = (x + w > SSD1306_WIDTH) ? SSD1306_WIDTH - x : w;
+  pages = (h + 7) / 8;
+
+  // Check if pixels are inverted
+  invert = (color == SSD1306_COLOR_BLACK) != (drvp->inv != 0);
+
+  for (page = 0; page < pages; page++, img += w) {
+    // Rows of this image page that belong to the image
+    mask = (page == pages - 1 && h % 8) ? 0xFF >> (8 - h % 8) : 0xFF;
+    dst = y / 8 + page;
+    if (dst >= SSD1306_PAGES) break;
+
+    // Aligned full page, a plain copy
+    if (shift == 0 && mask == 0xFF && !invert) {
+      memcpy(&drvp->fb[SSD1306_WIDTH * dst + x], img, cols);
+      markDirty(drvp, dst, x, x + cols - 1);
+      continue;
+    }
+
+    // Upper part of the page, shifted down in the destination page
+    row = &drvp->fb[SSD1306_WIDTH * dst + x];
+    for (col = 0; col < cols; col++) {
+      b = invert ? ~img[col] : img[col];
+      row[col] = (row[col] & ~(mask << shift)) | ((b & mask) << shift);
+    }
+    markDirty(drvp, dst, x, x + cols - 1);
+
+    // Lower part, in the next page
+    if (shift == 0 || (mask >> (8 - shift)) == 0 || dst + 1 >= SSD1306_PAGES) continue;
+    row += SSD1306_WIDTH;
+    for (col = 0; col < cols; col++) {
+      b = invert ? ~img[col] : img[col];
+      row[col] = (row[col] & ~(mask >> (8 - shift))) | ((b & mask) >> (8 - shift));
+    }
+    markDirty(drvp, dst + 1, x, x + cols - 1);
   }
 }
 
@@ -103,50 +476,95 @@ static void gotoXy(void *ip, uint8_t x, uint8_t y) {
   drvp->y = y;
 }
 
-static char PUTC(void *ip, char ch, const ssd1306_font_t *font, ssd1306_color_t color) {
-  SSD1306Driver *drvp = (SSD1306Driver *)ip;
-  uint32_t i, b, j;
+/*
+ * Draws the first n characters of str at the cursor, which the caller has
+ * already checked to fit on the display, and moves the cursor after them.
+ * Glyphs are stored in pages like blit images, so the rows are clipped
+ * and shifted once per string and every glyph column costs one or two
+ * masked byte writes per page instead of one drawPixel per pixel.
+ */
+static void drawGlyphs(SSD1306Driver *drvp, const char *str, uint8_t n,
+                       const ssd1306_font_t *font, ssd1306_color_t color) {
+  const uint8_t shift = drvp->y % 8;
+  const uint8_t pages = (font->fh + 7) / 8;
+  const uint16_t size = font->fw * pages;
+  const uint8_t x1 = drvp->x + n * font->fw - 1;
+  uint8_t page, dst, mask, lo, hi, i, col, b, inv;
+  const uint8_t *glyph;
+  uint8_t *row;
+
+  if (n == 0) return;
+
+  // Glyph bits are set for the given color, check if pixels are inverted
+  inv = ((color == SSD1306_COLOR_BLACK) != (drvp->inv != 0)) ? 0xFF : 0x00;
+
+  for (page = 0; page < pages; page++) {
+    // Rows of this glyph page, and where they land in two display pages
+    mask = (page == pages - 1 && font->fh % 8) ? 0xFF >> (8 - font->fh % 8) : 0xFF;
+    lo = mask << shift;
+    hi = shift ? mask >> (8 - shift) : 0;
+    dst = drvp->y / 8 + page;
+
+    row = &drvp->fb[SSD1306_WIDTH * dst + drvp->x];
+    for (i = 0; i < n; i++, row += font->fw) {
+      glyph = &font->dt[(str[i] - 32) * size + page * font->fw];
+      for (col = 0; col < font->fw; col++) {
+        b = (glyph[col] ^ inv) & mask;
+        row[col] = (row[col] & ~lo) | (uint8_t)(b << shift);
+        if (hi) {
+          row[col + SSD1306_WIDTH] = (row[col + SSD1306_WIDTH] & ~hi) | (b >> (8 - shift));
+        }
+      }
+    }
 
-  // Check available space in OLED
+    markDirty(drvp, dst, drvp->x, x1);
+    if (hi) {
+      markDirty(drvp, dst + 1, drvp->x, x1);
+    }
+  }
+
+  drvp->x = x1 + 1;
+}
+
+/* Number of characters that fit between the cursor and the display edges */
+static uint8_t fittingChars(SSD1306Driver *drvp, const ssd1306_font_t *font) {
   if (drvp->x + font->fw >= SSD1306_WIDTH ||
       drvp->y + font->fh >= SSD1306_HEIGHT) {
     return 0;
   }
 
-  // Go through font
-  for (i = 0; i < font->fh; i++) {
-    b = font->dt[(ch - 32) * font->fh + i];
-    for (j = 0; j < font->fw; j++) {
-      if ((b << j) & 0x8000) {
-        drawPixel(drvp, drvp->x + j, drvp->y + i, color);
-      } else {
-        drawPixel(drvp, drvp->x + j, drvp->y + i,(ssd1306_color_t)! color);
-      }
-    }
+  return (SSD1306_WIDTH - 1 - drvp->x) / font->fw;
+}
+
+static char PUTC(void *ip, char ch, const ssd1306_font_t *font, ssd1306_color_t color) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+
+  // Check available space in OLED
+  if (fittingChars(drvp, font) == 0) {
+    return 0;
   }
 
-  // Increase pointer
-  drvp->x += font->fw;
+  drawGlyphs(drvp, &ch, 1, font, color);
 
   // Return character written
   return ch;
 }
 
-static char PUTS(void *ip, char *str, const ssd1306_font_t *font, ssd1306_color_t color) {
-  // Write characters
-  while (*str) {
-    // Write character by character
-    if (PUTC(ip, *str, font, color) != *str) {
-      // Return error
-      return *str;
-    }
+static char PUTS(void *ip, const char *str, const ssd1306_font_t *font, ssd1306_color_t color) {
+  SSD1306Driver *drvp = (SSD1306Driver *)ip;
+  uint8_t fit, n;
 
-    // Increase string pointer
-    str++;
+  // Clip once for the whole string
+  fit = fittingChars(drvp, font);
+  n = 0;
+  while (n < fit && str[n]) {
+    n++;
   }
 
-  // Everything OK, zero should be returned
-  return *str;
+  drawGlyphs(drvp, str, n, font, color);
+
+  // Zero if everything was written, else the first character left out
+  return str[n];
 }
 
 void drawLine(void *ip, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, ssd1306_color_t color) {
@@ -266,7 +684,6 @@ void drawRect(void *ip, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ssd1306_
 void drawRectFill(void *ip, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ssd1306_color_t color) {
 
     SSD1306Driver *drvp = (SSD1306Driver *)ip;
-    uint8_t i;
 
     /* Check input parameters */
     if (
@@ -285,11 +702,8 @@ void drawRectFill(void *ip, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ssd1
         h = SSD1306_HEIGHT - y;
     }
 
-    /* Draw lines */
-    for (i = 0; i <= h; i++) {
-        /* Draw lines */
-        drawLine(drvp, x, y + i, x + w, y + i, color);
-    }
+    /* Fill the area, lines are drawn from x to x + w included */
+    fillRect(drvp, x, y, w + 1, h + 1, color);
 }
 
 void drawTri(void *ip, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, ssd1306_color_t color) {
@@ -434,15 +848,20 @@ void drawCircleFill(void *ip, int16_t x0, int16_t y0, int16_t r, ssd1306_color_t
 }
 
 static void setDisplay(void *ip, uint8_t on) {
-  wrCmd(ip, 0x8D);
-  wrCmd(ip, on ? 0x14 : 0x10);
-  wrCmd(ip, 0xAE);
+  const uint8_t cmds[] = {
+    0x8D,               // Set DC-DC enable
+    on ? 0x14 : 0x10,
+    on ? 0xAF : 0xAE,   // Display on/off
+  };
+
+  wrCmds(ip, cmds, sizeof(cmds));
 }
 
 static const struct SSD1306VMT vmt_ssd1306 = {
   updateScreen, toggleInvert, fillScreen, drawPixel,
   gotoXy, PUTC, PUTS, drawLine, drawRect, drawRectFill,
-  drawTri, drawTriFill, drawCircle, drawCircleFill, setDisplay
+  drawTri, drawTriFill, drawCircle, drawCircleFill, setDisplay,
+  swapBuffers, flushScreen, fillRect, blit
 };
 
 /*===========================================================================*/
@@ -452,6 +871,25 @@ static const struct SSD1306VMT vmt_ssd1306 = {
 void ssd1306ObjectInit(SSD1306Driver *devp) {
   devp->vmt = &vmt_ssd1306;
   devp->config = NULL;
+  devp->fb = &devp->fbmem[0][SSD1306_FB_HEADER];
+  devp->front = &devp->fbmem[1][SSD1306_FB_HEADER];
+  devp->shadow_valid = false;
+  devp->hmode = false;
+  memset(devp->dirty_x0, 0xFF, sizeof(devp->dirty_x0));
+  memset(devp->dirty_x1, 0, sizeof(devp->dirty_x1));
+  memset(devp->flush_x0, 0xFF, sizeof(devp->flush_x0));
+  memset(devp->flush_x1, 0, sizeof(devp->flush_x1));
+  devp->bytes = 0;
+  devp->transfers = 0;
+
+#if SSD1306_USE_PANEL_MODEL
+  // Reset state of the controller, with a RAM pattern no frame would have
+  memset(&devp->panel, 0, sizeof(devp->panel));
+  memset(devp->panel.ram, 0x5A, sizeof(devp->panel.ram));
+  devp->panel.mode = 0x02;
+  devp->panel.col_end = SSD1306_WIDTH - 1;
+  devp->panel.page_end = SSD1306_PAGES - 1;
+#endif
 
   devp->state = SSD1306_STOP;
 }
@@ -460,7 +898,7 @@ void ssd1306Start(SSD1306Driver *devp, const SSD1306Config *config) {
   const uint8_t cmds[] = {
     0xAE,   // display off
     0x20,   // Set memory address
-    0x10,   // 0x00: horizontal addressing mode, 0x01: vertical addressing mode
+    0x02,   // 0x00: horizontal, 0x01: vertical, 0x02: page addressing mode
     0xB0,   // Set page start address for page addressing mode: 0 ~ 7
     0xC8,   // Set COM output scan direction
     0x00,   // Set low column address
@@ -487,7 +925,6 @@ void ssd1306Start(SSD1306Driver *devp, const SSD1306Config *config) {
     0x14,
     0xAF,   // turn on SSD1306panel
   };
-  uint8_t idx;
 
   chDbgCheck((devp != NULL) && (config != NULL));
 
@@ -499,11 +936,10 @@ void ssd1306Start(SSD1306Driver *devp, const SSD1306Config *config) {
   chThdSleepMilliseconds(100);
 
   // OLED initialize
-  for (idx = 0; idx < sizeof(cmds); idx++) {
-    wrCmd(devp, cmds[idx]);
-  }
+  wrCmds(devp, cmds, sizeof(cmds));
 
-  // Clear screen
+  // Clear screen, the panel RAM content is unknown so the first update
+  // sends the whole frame
   fillScreen(devp, SSD1306_COLOR_WHITE);
 
   // Update screen
@@ -516,6 +952,25 @@ void ssd1306Start(SSD1306Driver *devp, const SSD1306Config *config) {
   devp->state = SSD1306_READY;
 }
 
+#if SSD1306_USE_PANEL_MODEL
+/*
+ * Returns true if the panel model and the shadow copy both hold exactly
+ * what a full update of the last flushed frame would have written.
+ */
+bool ssd1306PanelMatches(const SSD1306Driver *devp) {
+  uint8_t idx;
+
+  for (idx = 0; idx < SSD1306_PAGES; idx++) {
+    if (memcmp(devp->panel.ram[idx], &devp->front[SSD1306_WIDTH * idx],
+               SSD1306_WIDTH) != 0) {
+      return false;
+    }
+  }
+
+  return memcmp(devp->shadow, devp->front, SSD1306_FB_SIZE) == 0;
+}
+#endif
+
 void ssd1306Stop(SSD1306Driver *devp) {
   chDbgAssert((devp->state == SSD1306_STOP) || (devp->state == SSD1306_READY),
               "ssd1306Stop(), invalid state");
@@ -4,6 +4,29 @@
 
 #include "hal.h"
 
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Keeps a model of the panel display RAM fed with every byte
+ *          sent on the bus, so that partial updates can be checked
+ *          against the framebuffer (costs 1 KB of RAM). The tournament
+ *          build enables it.
+ */
+#if !defined(SSD1306_USE_PANEL_MODEL) || defined(__DOXYGEN__)
+#define SSD1306_USE_PANEL_MODEL         FALSE
+#endif
+
+/**
+ * @brief   If not zero the bus is not used: every transaction only waits
+ *          the time it would take at this I2C clock, so that the frame
+ *          timing can be studied without a panel, e.g. on the host.
+ */
+#if !defined(SSD1306_SIMULATED_BUS_HZ) || defined(__DOXYGEN__)
+#define SSD1306_SIMULATED_BUS_HZ        0
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -14,7 +37,12 @@
 
 #define SSD1306_WIDTH                   128
 #define SSD1306_HEIGHT                  64
-#define SSD1306_WIDTH_FIXED             (SSD1306_WIDTH + 1)
+#define SSD1306_PAGES                   (SSD1306_HEIGHT / 8)
+#define SSD1306_FB_SIZE                 (SSD1306_WIDTH * SSD1306_PAGES)
+
+/* Room reserved in front of the framebuffer for the commands and the
+   control byte of a full update, keeps the framebuffer word aligned */
+#define SSD1306_FB_HEADER               20
 
 
 /*===========================================================================*/
@@ -29,7 +57,7 @@ typedef enum {
 typedef struct {
     uint8_t fw;
     uint8_t fh;
-    const uint16_t *dt;
+    const uint8_t *dt;  /* Glyphs from ' ' to '~', stored in pages like fb */
 } ssd1306_font_t;
 
 typedef enum {
@@ -43,6 +71,19 @@ typedef enum {
     SSD1306_READY = 2,
 } ssd1306_state_t;
 
+#if SSD1306_USE_PANEL_MODEL || defined(__DOXYGEN__)
+typedef struct {
+    uint8_t ram[SSD1306_PAGES][SSD1306_WIDTH];
+    uint8_t mode;               /* 0x00 horizontal, 0x02 page addressing */
+    uint8_t page;
+    uint8_t col;
+    uint8_t col_start, col_end;
+    uint8_t page_start, page_end;
+    uint8_t cmd;                /* Command waiting for its arguments */
+    uint8_t args;               /* Arguments still expected by cmd */
+} ssd1306_panel_t;
+#endif
+
 typedef struct {
     I2CDriver *i2cp;
     const I2CConfig *i2ccfg;
@@ -57,7 +98,7 @@ typedef struct {
     void (*drawPixel)(void *ip, uint8_t x, uint8_t y, ssd1306_color_t color); \
     void (*gotoXy)(void *ip, uint8_t x, uint8_t y); \
     char (*putc)(void *ip, char ch, const ssd1306_font_t *font, ssd1306_color_t color); \
-    char (*puts)(void *ip, char *str, const ssd1306_font_t *font, ssd1306_color_t color); \
+    char (*puts)(void *ip, const char *str, const ssd1306_font_t *font, ssd1306_color_t color); \
     void (*drawLine)(void *ip, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, ssd1306_color_t color); \
     void (*drawRect)(void *ip, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ssd1306_color_t color); \
     void (*drawRectFill)(void *ip, uint16_t x, uint16_t y, uint16_t w, uint16_t h, ssd1306_color_t color); \
@@ -65,7 +106,11 @@ typedef struct {
     void (*drawTriFill)(void *ip, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, ssd1306_color_t color); \
     void (*drawCircle)(void *ip, int16_t x0, int16_t y0, int16_t r, ssd1306_color_t color); \
     void (*drawCircleFill)(void *ip, int16_t x0, int16_t y0, int16_t r, ssd1306_color_t color); \
-    void (*setDisplay)(void *ip, uint8_t on);
+    void (*setDisplay)(void *ip, uint8_t on); \
+    void (*swapBuffers)(void *ip); \
+    void (*flushScreen)(void *ip); \
+    void (*fillRect)(void *ip, uint8_t x, uint8_t y, uint8_t w, uint8_t h, ssd1306_color_t color); \
+    void (*blit)(void *ip, const uint8_t *img, uint8_t w, uint8_t h, uint8_t x, uint8_t y, ssd1306_color_t color);
 
 struct SSD1306VMT {
     _ssd1306_methods
@@ -82,7 +127,23 @@ typedef struct SSD1306Driver {
     uint8_t x;
     uint8_t y;
     uint8_t inv;
-    uint8_t fb[SSD1306_WIDTH_FIXED * SSD1306_HEIGHT / 8];
+    /* Columns of fb modified since the last swap, empty if x0 > x1 */
+    uint8_t dirty_x0[SSD1306_PAGES];
+    uint8_t dirty_x1[SSD1306_PAGES];
+    /* Columns of front to compare against the shadow at the next flush */
+    uint8_t flush_x0[SSD1306_PAGES];
+    uint8_t flush_x1[SSD1306_PAGES];
+    uint32_t bytes;     /* Bytes transmitted on the bus since ssd1306ObjectInit */
+    uint32_t transfers; /* I2C transactions since ssd1306ObjectInit */
+    uint8_t hmode;      /* Panel left in horizontal addressing mode */
+    uint8_t *fb;        /* Back buffer, page after page, target of drawing */
+    uint8_t *front;     /* Front buffer, last swapped frame to transmit */
+    uint8_t fbmem[2][SSD1306_FB_HEADER + SSD1306_FB_SIZE] __attribute__((aligned(4)));
+    uint8_t shadow[SSD1306_FB_SIZE] __attribute__((aligned(4)));  /* Panel RAM content */
+    bool shadow_valid;
+#if SSD1306_USE_PANEL_MODEL
+    ssd1306_panel_t panel;
+#endif
 } SSD1306Driver;
 
 /*===========================================================================*/
@@ -92,6 +153,12 @@ typedef struct SSD1306Driver {
 #define ssd1306UpdateScreen(ip) \
     (ip)->vmt->updateScreen(ip)
 
+#define ssd1306SwapBuffers(ip) \
+    (ip)->vmt->swapBuffers(ip)
+
+#define ssd1306FlushScreen(ip) \
+    (ip)->vmt->flushScreen(ip)
+
 #define ssd1306ToggleInvert(ip) \
     (ip)->vmt->toggleInvert(ip)
 
@@ -119,6 +186,12 @@ typedef struct SSD1306Driver {
 #define ssd1306DrawRectangleFill(ip, x, y, w, h, color) \
     (ip)->vmt->drawRectFill(ip, x, y, w, h, color)
 
+#define ssd1306FillRect(ip, x, y, w, h, color) \
+    (ip)->vmt->fillRect(ip, x, y, w, h, color)
+
+#define ssd1306Blit(ip, img, w, h, x, y, color) \
+    (ip)->vmt->blit(ip, img, w, h, x, y, color)
+
 #define ssd1306DrawTriangle(ip, x1, y1, x2, y2, x3, y3, color) \
     (ip)->vmt->drawTri(ip, x1, y1, x2, y2, x3, y3, color)
 
@@ -134,6 +207,12 @@ typedef struct SSD1306Driver {
 #define ssd1306SetDisplay(ip, on) \
     (ip)->vmt->setDisplay(ip, on)
 
+#define ssd1306GetBytesSent(ip) \
+    ((ip)->bytes)
+
+#define ssd1306GetTransfers(ip) \
+    ((ip)->transfers)
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -148,6 +227,9 @@ extern const ssd1306_font_t ssd1306_font_11x18;
 void ssd1306ObjectInit(SSD1306Driver *devp);
 void ssd1306Start(SSD1306Driver *devp, const SSD1306Config *config);
 void ssd1306Stop(SSD1306Driver *devp);
+#if SSD1306_USE_PANEL_MODEL
+bool ssd1306PanelMatches(const SSD1306Driver *devp);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Converte i font di tools/fonts (PBM in formato testo, "P1", con i glifi
+dal carattere 32 al 126 uno sotto l'altro) nel formato delle pagine del
+display SSD1306 e li scrive nei sorgenti del driver in ssd1306/.
+
+Ogni glifo largo fw ed alto fh pixel occupa fw * (fh + 7) / 8 byte:
+una pagina di 8 righe dopo l'altra, un byte per colonna, col bit meno
+significativo sulla riga più in alto, come le immagini generate da
+tools/convert_images.py. Così il driver scrive un glifo con pochi byte
+per colonna invece di un pixel alla volta.
+
+Uso:
+
+    python3 tools/convert_fonts.py [-d tools/fonts] [-o ssd1306]
+"""
+
+import argparse
+import os
+
+from convert_images import read_pbm, to_pages
+
+# File del font, sorgente generato, nome dell'array e del font.
+FONTS = [
+    ("font_7x10", "ssd1306_font_7_10.c", "FONT_7x10_DATA", "ssd1306_font_7x10"),
+    ("font_11x18", "ssd1306_font.c", "FONT_11x18_DATA", "ssd1306_font_11x18"),
+]
+
+FIRST_CHAR = 32
+LAST_CHAR = 126
+
+
+def glyph_name(c):
+    if c == " ":
+        return "// sp"
+    if c == "\\":
+        return "/* \\ */"
+    return "// " + c
+
+
+def convert(path, out_path, array, font):
+    width, height, pixels = read_pbm(path)
+    glyphs = LAST_CHAR - FIRST_CHAR + 1
+    if height % glyphs:
+        raise ValueError("%s: height must be a multiple of %d glyphs" % (path, glyphs))
+    fh = height // glyphs
+
+    with open(out_path, "w", encoding="latin-1") as f:
+        f.write("/* Thanks to https://stm32f4-discovery.net/2015/05/library-61-ssd1306-oled-i2c-lcd-for-stm32f4xx/ */\n")
+        f.write("/* Generated by tools/convert_fonts.py from tools/fonts/%s, do not edit.\n"
+                % os.path.basename(path))
+        f.write("   Each glyph is stored in pages like the framebuffer. */\n")
+        f.write("static const uint8_t %s[] = {\n" % array)
+        for g in range(glyphs):
+            data = to_pages(width, fh, pixels[g * fh:(g + 1) * fh])
+            f.write("  " + " ".join("0x%02x," % v for v in data))
+            f.write("  %s\n" % glyph_name(chr(FIRST_CHAR + g)))
+        f.write("};\n\n")
+        f.write("const ssd1306_font_t %s = {\n" % font)
+        f.write("  %d, %d, %s\n" % (width, fh, array))
+        f.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-d", "--fonts", default=os.path.join("tools", "fonts"))
+    parser.add_argument("-o", "--output", default="ssd1306")
+    args = parser.parse_args()
+
+    for name, source, array, font in FONTS:
+        convert(os.path.join(args.fonts, name + ".pbm"),
+                os.path.join(args.output, source), array, font)
+
+
+if __name__ == "__main__":
+    main()
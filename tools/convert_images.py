@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Converte le immagini di tools/images (PBM in formato testo, "P1") nel
+formato delle pagine del display SSD1306 e le scrive come array C in
+assets.c ed assets.h.
+
+Un'immagine alta h pixel è divisa in (h + 7) / 8 pagine di 8 righe.
+Ogni pagina è una sequenza di byte, uno per colonna, e il bit meno
+significativo di ogni byte è la riga più in alto della pagina: è lo
+stesso formato del framebuffer, quindi Display_drawImage copia byte
+interi invece di singoli pixel. I bit delle righe oltre h valgono 0.
+
+Uso:
+
+    python3 tools/convert_images.py [-d tools/images] [-o .]
+"""
+
+import argparse
+import os
+
+# Nome dell'immagine (file <nome>.pbm e array <nome>_image) e
+# prefisso delle sue costanti in assets.h.
+IMAGES = [
+    ("snake", "SNAKE"),
+    ("game_over", "GAME_OVER"),
+    ("title", "TITLE"),
+    ("win", "WIN"),
+]
+
+
+def read_pbm(path):
+    tokens = []
+    with open(path, encoding="latin-1") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if line:
+                tokens.append(line)
+
+    if tokens[0] != "P1":
+        raise ValueError("%s: only plain PBM (P1) images are supported" % path)
+    width, height = (int(v) for v in tokens[1].split())
+    bits = "".join(tokens[2:]).replace(" ", "")
+    if len(bits) != width * height:
+        raise ValueError("%s: expected %d pixels, found %d" % (path, width * height, len(bits)))
+
+    return width, height, [[bits[y * width + x] == "1" for x in range(width)] for y in range(height)]
+
+
+def to_pages(width, height, pixels):
+    data = []
+    for page in range((height + 7) // 8):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and pixels[y][x]:
+                    byte |= 1 << bit
+            data.append(byte)
+    return data
+
+
+def write_assets(out_dir, images):
+    with open(os.path.join(out_dir, "assets.h"), "w", encoding="latin-1") as f:
+        f.write("/* Generato da tools/convert_images.py.\n")
+        f.write(" * Non modificare a mano: rigenerare con lo script.\n */\n")
+        f.write("#ifndef ASSETS_H\n#define ASSETS_H\n\n")
+        f.write("// Numero di pagine (gruppi di 8 righe) di un'immagine alta h pixel.\n")
+        f.write("#define IMAGE_PAGES(h) (((h) + 7) / 8)\n\n")
+        for name, prefix, width, height, _ in images:
+            f.write("#define %s_RES_X %d\n" % (prefix, width))
+            f.write("#define %s_RES_Y %d\n" % (prefix, height))
+        for name, prefix, _, _, _ in images:
+            f.write("extern const unsigned char %s_image[%s_RES_X*IMAGE_PAGES(%s_RES_Y)];\n"
+                    % (name, prefix, prefix))
+        f.write("#endif\n")
+
+    with open(os.path.join(out_dir, "assets.c"), "w", encoding="latin-1") as f:
+        f.write("/* Generato da tools/convert_images.py.\n")
+        f.write(" * Non modificare a mano: rigenerare con lo script.\n */\n")
+        f.write('#include "assets.h"\n')
+        for name, prefix, _, _, data in images:
+            f.write("\nconst unsigned char %s_image[%s_RES_X*IMAGE_PAGES(%s_RES_Y)] = {\n"
+                    % (name, prefix, prefix))
+            for i in range(0, len(data), 8):
+                f.write("  " + " ".join("0x%02x," % v for v in data[i:i + 8]) + "\n")
+            f.write("};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-d", "--images", default=os.path.join("tools", "images"))
+    parser.add_argument("-o", "--output", default=".")
+    args = parser.parse_args()
+
+    images = []
+    for name, prefix in IMAGES:
+        width, height, pixels = read_pbm(os.path.join(args.images, name + ".pbm"))
+        images.append((name, prefix, width, height, to_pages(width, height, pixels)))
+
+    write_assets(args.output, images)
+
+
+if __name__ == "__main__":
+    main()
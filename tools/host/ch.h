@@ -0,0 +1,94 @@
+/*
+ * Sostituto di ChibiOS/RT per compilare il torneo sull'host: solo
+ * le funzioni usate dal gioco, implementate in host.c con i thread
+ * POSIX. Il tempo di sistema ha la stessa frequenza di cfg/chconf.h
+ * ed il contatore realtime conta cicli a STM32_HCLK.
+ */
+#ifndef CH_H
+#define CH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define TRUE  1
+#define FALSE 0
+
+typedef int32_t  msg_t;
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef uint32_t rtcnt_t;
+typedef uint32_t tprio_t;
+typedef uint64_t stkalign_t;
+
+#define MSG_OK      0
+#define MSG_TIMEOUT -1
+#define MSG_RESET   -2
+
+#define NORMALPRIO 128
+
+#define CH_CFG_ST_FREQUENCY 10000
+
+#define TIME_IMMEDIATE ((sysinterval_t) 0)
+#define TIME_INFINITE  ((sysinterval_t) -1)
+#define TIME_MS2I(ms)  ((sysinterval_t) ((ms) * (CH_CFG_ST_FREQUENCY / 1000)))
+#define TIME_I2MS(i)   ((uint32_t) (i) / (CH_CFG_ST_FREQUENCY / 1000))
+
+#define chDbgCheck(c)     ((void) (c))
+#define chDbgAssert(c, r) ((void) (c))
+
+/* Gli stack sono quelli dei thread POSIX: le aree di lavoro restano
+   solo perché le strutture del gioco le contengono. */
+#define THD_WORKING_AREA(s, n)   stkalign_t s[((n) + sizeof(stkalign_t) - 1) / sizeof(stkalign_t)]
+#define THD_FUNCTION(tname, arg) void tname(void *arg)
+
+typedef struct thread thread_t;
+typedef void (*tfunc_t)(void *arg);
+
+typedef struct {
+  pthread_mutex_t mutex;
+} mutex_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  bool            taken;
+} binary_semaphore_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  msg_t          *buffer;
+  size_t          size;
+  size_t          head;
+  size_t          count;
+} mailbox_t;
+
+void chSysInit(void);
+void chSysHalt(const char *reason);
+
+void chMtxObjectInit(mutex_t *mp);
+void chMtxLock(mutex_t *mp);
+void chMtxUnlock(mutex_t *mp);
+
+void  chBSemObjectInit(binary_semaphore_t *bsp, bool taken);
+msg_t chBSemWait(binary_semaphore_t *bsp);
+void  chBSemSignal(binary_semaphore_t *bsp);
+
+void  chMBObjectInit(mailbox_t *mbp, msg_t *buf, size_t n);
+msg_t chMBPostTimeout(mailbox_t *mbp, msg_t msg, sysinterval_t timeout);
+msg_t chMBFetchTimeout(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout);
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg);
+msg_t     chThdWait(thread_t *tp);
+void      chThdExit(msg_t msg);
+void      chThdSleepMilliseconds(uint32_t msec);
+void      chThdSleepMicroseconds(uint32_t usec);
+void      chRegSetThreadName(const char *name);
+
+systime_t     chVTGetSystemTimeX(void);
+sysinterval_t chVTTimeElapsedSinceX(systime_t start);
+rtcnt_t       chSysGetRealtimeCounterX(void);
+
+#endif /* CH_H */
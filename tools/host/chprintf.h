@@ -0,0 +1,14 @@
+/*
+ * Sostituto di chprintf.h per il torneo sull'host: tutti gli stream
+ * sono lo standard output (vedi host.c).
+ */
+#ifndef CHPRINTF_H
+#define CHPRINTF_H
+
+#include <stdarg.h>
+#include "hal.h"
+
+int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap);
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...);
+
+#endif /* CHPRINTF_H */
@@ -0,0 +1,86 @@
+/*
+ * Sostituto di ChibiOS/HAL per il torneo sull'host (vedi ch.h): il
+ * bus I2C accetta ogni trasmissione senza inviarla, e la seriale è
+ * lo standard output.
+ */
+#ifndef HAL_H
+#define HAL_H
+
+#include "ch.h"
+
+#define HAL_USE_I2C TRUE
+
+#define STM32_HCLK 84000000
+
+#define US2RTC(freq, usec) ((rtcnt_t) ((((freq) + 999999UL) / 1000000UL) * (usec)))
+#define RTC2US(freq, n)    ((((n) - 1UL) / ((freq) / 1000000UL)) + 1UL)
+
+void halInit(void);
+
+typedef int ioline_t;
+typedef int iomode_t;
+typedef void ioportid_t;
+
+#define GPIOA ((ioportid_t*) 0)
+
+#define PAL_MODE_ALTERNATE(n)     ((iomode_t) (n))
+#define PAL_STM32_OTYPE_OPENDRAIN 0
+#define PAL_STM32_OSPEED_HIGHEST  0
+#define PAL_STM32_PUPDR_PULLUP    0
+
+#define LINE_ARD_D14 14
+#define LINE_ARD_D15 15
+
+void palSetLineMode(ioline_t line, iomode_t mode);
+void palSetPadMode(ioportid_t *port, int pad, iomode_t mode);
+
+typedef uint16_t i2caddr_t;
+
+typedef enum {
+  OPMODE_I2C = 1,
+} i2copmode_t;
+
+typedef enum {
+  FAST_DUTY_CYCLE_2 = 2,
+} i2cdutycycle_t;
+
+typedef struct {
+  i2copmode_t    op_mode;
+  uint32_t       clock_speed;
+  i2cdutycycle_t duty_cycle;
+} I2CConfig;
+
+typedef struct {
+  const I2CConfig *config;
+} I2CDriver;
+
+extern I2CDriver I2CD1;
+
+void  i2cStart(I2CDriver *i2cp, const I2CConfig *config);
+void  i2cAcquireBus(I2CDriver *i2cp);
+void  i2cReleaseBus(I2CDriver *i2cp);
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr,
+                               const uint8_t *txbuf, size_t txbytes,
+                               uint8_t *rxbuf, size_t rxbytes,
+                               sysinterval_t timeout);
+
+typedef struct {
+  int dummy;
+} BaseSequentialStream;
+
+typedef enum {
+  SD_UNINIT = 0,
+  SD_STOP   = 1,
+  SD_READY  = 2,
+} sdstate_t;
+
+typedef struct {
+  BaseSequentialStream stream;
+  sdstate_t            state;
+} SerialDriver;
+
+extern SerialDriver SD2;
+
+void sdStart(SerialDriver *sdp, const void *config);
+
+#endif /* HAL_H */
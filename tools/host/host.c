@@ -0,0 +1,294 @@
+/*
+ * Implementazione delle funzioni di ch.h, hal.h e chprintf.h per il
+ * torneo sull'host, con i thread POSIX. Le priorità sono ignorate:
+ * il torneo usa solo giocatori sincroni, ed il thread del display
+ * passa il tempo ad aspettare.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+I2CDriver    I2CD1;
+SerialDriver SD2;
+
+struct thread {
+  pthread_t thread;
+  tfunc_t   function;
+  void     *arg;
+};
+
+static uint64_t monotonicNanoseconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void check(int error, const char *what)
+{
+  if (error != 0) {
+    fprintf(stderr, "%s: %s\n", what, strerror(error));
+    abort();
+  }
+}
+
+void chSysInit(void)
+{
+}
+
+void chSysHalt(const char *reason)
+{
+  fflush(stdout);
+  fprintf(stderr, "chSysHalt: %s\n", reason);
+  abort();
+}
+
+void chMtxObjectInit(mutex_t *mp)
+{
+  check(pthread_mutex_init(&mp->mutex, 0), "pthread_mutex_init");
+}
+
+void chMtxLock(mutex_t *mp)
+{
+  check(pthread_mutex_lock(&mp->mutex), "pthread_mutex_lock");
+}
+
+void chMtxUnlock(mutex_t *mp)
+{
+  check(pthread_mutex_unlock(&mp->mutex), "pthread_mutex_unlock");
+}
+
+void chBSemObjectInit(binary_semaphore_t *bsp, bool taken)
+{
+  check(pthread_mutex_init(&bsp->mutex, 0), "pthread_mutex_init");
+  check(pthread_cond_init(&bsp->cond, 0), "pthread_cond_init");
+  bsp->taken = taken;
+}
+
+msg_t chBSemWait(binary_semaphore_t *bsp)
+{
+  pthread_mutex_lock(&bsp->mutex);
+  while (bsp->taken)
+    pthread_cond_wait(&bsp->cond, &bsp->mutex);
+  bsp->taken = true;
+  pthread_mutex_unlock(&bsp->mutex);
+  return MSG_OK;
+}
+
+void chBSemSignal(binary_semaphore_t *bsp)
+{
+  pthread_mutex_lock(&bsp->mutex);
+  bsp->taken = false;
+  pthread_cond_signal(&bsp->cond);
+  pthread_mutex_unlock(&bsp->mutex);
+}
+
+void chMBObjectInit(mailbox_t *mbp, msg_t *buf, size_t n)
+{
+  check(pthread_mutex_init(&mbp->mutex, 0), "pthread_mutex_init");
+  check(pthread_cond_init(&mbp->cond, 0), "pthread_cond_init");
+  mbp->buffer = buf;
+  mbp->size = n;
+  mbp->head = 0;
+  mbp->count = 0;
+}
+
+/* Aspetta che [ready] sia vera fino a [timeout] tick di sistema. */
+static bool waitMailbox(mailbox_t *mbp, bool (*ready)(const mailbox_t *),
+                        sysinterval_t timeout)
+{
+  if (timeout == TIME_INFINITE) {
+    while (!ready(mbp))
+      pthread_cond_wait(&mbp->cond, &mbp->mutex);
+    return true;
+  }
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  uint64_t ns = deadline.tv_nsec + (uint64_t) timeout * (1000000000u / CH_CFG_ST_FREQUENCY);
+  deadline.tv_sec += ns / 1000000000u;
+  deadline.tv_nsec = ns % 1000000000u;
+
+  while (!ready(mbp))
+    if (timeout == TIME_IMMEDIATE
+        || pthread_cond_timedwait(&mbp->cond, &mbp->mutex, &deadline) == ETIMEDOUT)
+      return ready(mbp);
+  return true;
+}
+
+static bool hasRoom(const mailbox_t *mbp)
+{
+  return mbp->count < mbp->size;
+}
+
+static bool hasMessage(const mailbox_t *mbp)
+{
+  return mbp->count > 0;
+}
+
+msg_t chMBPostTimeout(mailbox_t *mbp, msg_t msg, sysinterval_t timeout)
+{
+  pthread_mutex_lock(&mbp->mutex);
+  bool posted = waitMailbox(mbp, hasRoom, timeout);
+  if (posted) {
+    mbp->buffer[(mbp->head + mbp->count) % mbp->size] = msg;
+    mbp->count++;
+    pthread_cond_broadcast(&mbp->cond);
+  }
+  pthread_mutex_unlock(&mbp->mutex);
+  return posted ? MSG_OK : MSG_TIMEOUT;
+}
+
+msg_t chMBFetchTimeout(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout)
+{
+  pthread_mutex_lock(&mbp->mutex);
+  bool fetched = waitMailbox(mbp, hasMessage, timeout);
+  if (fetched) {
+    *msgp = mbp->buffer[mbp->head];
+    mbp->head = (mbp->head + 1) % mbp->size;
+    mbp->count--;
+    pthread_cond_broadcast(&mbp->cond);
+  }
+  pthread_mutex_unlock(&mbp->mutex);
+  return fetched ? MSG_OK : MSG_TIMEOUT;
+}
+
+static void *threadStart(void *arg)
+{
+  thread_t *tp = arg;
+  tp->function(tp->arg);
+  return 0;
+}
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg)
+{
+  (void) wsp;
+  (void) size;
+  (void) prio;
+
+  thread_t *tp = malloc(sizeof(*tp));
+  if (tp == 0)
+    chSysHalt("out of memory");
+  tp->function = pf;
+  tp->arg = arg;
+  check(pthread_create(&tp->thread, 0, threadStart, tp), "pthread_create");
+  return tp;
+}
+
+msg_t chThdWait(thread_t *tp)
+{
+  check(pthread_join(tp->thread, 0), "pthread_join");
+  free(tp);
+  return MSG_OK;
+}
+
+void chThdExit(msg_t msg)
+{
+  (void) msg;
+  pthread_exit(0);
+}
+
+void chThdSleepMicroseconds(uint32_t usec)
+{
+  struct timespec ts = { usec / 1000000, (usec % 1000000) * 1000 };
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    ;
+}
+
+void chThdSleepMilliseconds(uint32_t msec)
+{
+  chThdSleepMicroseconds(msec * 1000);
+}
+
+void chRegSetThreadName(const char *name)
+{
+  (void) name;
+}
+
+systime_t chVTGetSystemTimeX(void)
+{
+  return (systime_t) (monotonicNanoseconds() / (1000000000u / CH_CFG_ST_FREQUENCY));
+}
+
+sysinterval_t chVTTimeElapsedSinceX(systime_t start)
+{
+  return chVTGetSystemTimeX() - start;
+}
+
+rtcnt_t chSysGetRealtimeCounterX(void)
+{
+  return (rtcnt_t) (monotonicNanoseconds() * (STM32_HCLK / 1000000) / 1000);
+}
+
+void halInit(void)
+{
+}
+
+void palSetLineMode(ioline_t line, iomode_t mode)
+{
+  (void) line;
+  (void) mode;
+}
+
+void palSetPadMode(ioportid_t *port, int pad, iomode_t mode)
+{
+  (void) port;
+  (void) pad;
+  (void) mode;
+}
+
+void i2cStart(I2CDriver *i2cp, const I2CConfig *config)
+{
+  i2cp->config = config;
+}
+
+void i2cAcquireBus(I2CDriver *i2cp)
+{
+  (void) i2cp;
+}
+
+void i2cReleaseBus(I2CDriver *i2cp)
+{
+  (void) i2cp;
+}
+
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr,
+                               const uint8_t *txbuf, size_t txbytes,
+                               uint8_t *rxbuf, size_t rxbytes,
+                               sysinterval_t timeout)
+{
+  (void) i2cp;
+  (void) addr;
+  (void) txbuf;
+  (void) txbytes;
+  (void) rxbuf;
+  (void) rxbytes;
+  (void) timeout;
+  return MSG_OK;
+}
+
+void sdStart(SerialDriver *sdp, const void *config)
+{
+  (void) config;
+  sdp->state = SD_READY;
+}
+
+int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap)
+{
+  (void) chp;
+  return vprintf(fmt, ap);
+}
+
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  int n = chvprintf(chp, fmt, ap);
+  va_end(ap);
+  return n;
+}
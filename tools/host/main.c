@@ -0,0 +1,45 @@
+/*
+ * Torneo di tournament.c sull'host.
+ *
+ *   tournament             controlli e tutte le serie, come sulla scheda
+ *   tournament -l          elenca le serie
+ *   tournament -c          solo i controlli (vedi Tournament_runChecks)
+ *   tournament SERIE...    solo le serie indicate
+ *
+ * Esce con 1 se una baseline o un controllo non sono rispettati.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "display.h"
+#include "tournament.h"
+
+int main(int argc, char **argv)
+{
+  if (argc == 2 && strcmp(argv[1], "-l") == 0) {
+    const char *name;
+    for (unsigned int i = 0; (name = Tournament_getSeriesName(i)) != 0; ++i)
+      printf("%s\n", name);
+    return 0;
+  }
+
+  halInit();
+  chSysInit();
+
+  // Come in main.c sulla scheda.
+  Display_init();
+  Display_changeResolution(4, 4);
+
+  _Bool passed = 1;
+  if (argc == 1)
+    passed = Tournament_run();
+  else if (argc == 2 && strcmp(argv[1], "-c") == 0)
+    passed = Tournament_runChecks();
+  else
+    for (int i = 1; i < argc; ++i)
+      passed = Tournament_runSeries(argv[i]) && passed;
+
+  fflush(stdout);
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""
+Esegue il torneo di tournament.c sull'host, una serie per processo su
+tutti i core, e ne scrive i risultati in JSON.
+
+Ogni serie è un processo tools/host/tournament con il nome della
+serie; un processo in più esegue i controlli (tournament -c). Le righe
+CSV diventano un oggetto per giocatore, con i numeri come interi, e le
+righe "# " le note della serie. Il risultato ha la forma
+
+    {"passed": true,
+     "checks": {"passed": true, "notes": [...]},
+     "series": {"royale": {"passed": true, "players": [...], "notes": [...]}}}
+
+I tempi per decisione dipendono dal carico: con più processi che core
+le serie con un budget di tempo (search_budget_*) cambiano risultato.
+
+Uso:
+
+    make -C tools/host
+    python3 tools/host/run_tournament.py [-j N] [-o risultati.json] [SERIE...]
+
+Esce con 1 se una baseline o un controllo non sono rispettati.
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def value(text):
+    try:
+        return int(text)
+    except ValueError:
+        return text
+
+
+def parse(output):
+    """Ritorna le righe CSV come dizionari e le note."""
+    header, players, notes = None, [], []
+    for line in output.splitlines():
+        if line.startswith("# "):
+            notes.append(line[2:])
+        elif line.startswith("series,"):
+            header = line.split(",")
+        elif header and line.count(",") == len(header) - 1:
+            players.append({k: value(v) for k, v in zip(header, line.split(","))})
+    return players, notes
+
+
+def run(binary, args):
+    result = subprocess.run([binary] + args, stdout=subprocess.PIPE,
+                            universal_newlines=True)
+    players, notes = parse(result.stdout)
+    return {"passed": result.returncode == 0, "players": players, "notes": notes}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("series", nargs="*", help="serie da eseguire (tutte se omesse)")
+    parser.add_argument("-b", "--binary", default=os.path.join(HERE, "tournament"))
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count())
+    parser.add_argument("-o", "--output")
+    args = parser.parse_args()
+
+    names = args.series
+    if not names:
+        names = subprocess.check_output([args.binary, "-l"],
+                                        universal_newlines=True).split()
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        checks = pool.submit(run, args.binary, ["-c"])
+        series = {name: pool.submit(run, args.binary, [name]) for name in names}
+        checks = checks.result()
+        series = {name: future.result() for name, future in series.items()}
+
+    del checks["players"]
+    results = {
+        "passed": checks["passed"] and all(s["passed"] for s in series.values()),
+        "checks": checks,
+        "series": series,
+    }
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+    else:
+        json.dump(results, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+    return 0 if results["passed"] else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+Calcola lo stack usato nel caso peggiore a partire da alcune funzioni,
+leggendo i grafi delle chiamate scritti da GCC con -fcallgraph-info=su
+(un file .ci per ogni sorgente, accanto al file oggetto).
+
+Le chiamate tramite puntatore (ad esempio in [Joystick_getButton])
+non hanno una destinazione nel grafo: con --indirect CHIAMANTE=F1,F2
+si indicano le funzioni che il chiamante può chiamare così, e per ogni
+chiamata indiretta si conta la peggiore. Un nome senza file
+(getButton) indica tutte le funzioni con quel nome, anche statiche.
+Le chiamate indirette senza destinazione contano come --extern.
+Una funzione con chiamate indirette può comparire più volte nel
+cammino, ma le sue destinazioni che sono già nel cammino vengono
+saltate: sono involucri che chiamano un altro oggetto dello stesso
+tipo (ad esempio il TimedJoystick del torneo). Le altre ricorsioni
+sono errori.
+
+Le funzioni senza grafo (libreria C, ChibiOS se non compilato con la
+stessa opzione) contano --extern byte e sono elencate alla fine.
+
+Uso, per i valori *_STACK_USAGE di config.h:
+
+    make USE_COPT=-fcallgraph-info=su
+    python3 tools/stack_usage.py build/obj --extern 128 \\
+        --root workerLoop --root flushLoop --root main \\
+        --indirect Joystick_getButton=getButton,TimedJoystick_getButton \\
+        --indirect Joystick_free=free \\
+        --indirect bfs=isApple,isTarget \\
+        --indirect Display_drawPixel=fillRect \\
+        --indirect Display_clear=fillScreen \\
+        --indirect Display_update=swapBuffers,flushScreen,updateScreen \\
+        --indirect Display_drawImage=blit \\
+        --indirect Display_drawText=gotoXy,PUTS \\
+        --indirect flushLoop=flushScreen \\
+        --indirect stbsp_vsprintfcb=stbsp__clamp_callback,stbsp__count_clamp_callback
+
+(MAIN_STACK_USAGE va misurato anche con make USE_TOURNAMENT=yes.)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+NODE = re.compile(r'node: \{ title: "([^"]+)" label: "([^"]*)"')
+EDGE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+SIZE = re.compile(r'\\n(\d+) bytes \(([a-z,]+)\)')
+
+INDIRECT = "__indirect_call"
+
+
+def read_graphs(paths):
+    frames = {}
+    qualifiers = {}
+    calls = {}
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                m = NODE.match(line)
+                if m:
+                    size = SIZE.search(m.group(2))
+                    if size:
+                        frames[m.group(1)] = int(size.group(1))
+                        qualifiers[m.group(1)] = size.group(2)
+                    continue
+                m = EDGE.match(line)
+                if m:
+                    calls.setdefault(m.group(1), []).append(m.group(2))
+    return frames, qualifiers, calls
+
+
+def find(frames, name):
+    if name in frames:
+        return [name]
+    return sorted(t for t in frames if t.split(":")[-1] == name)
+
+
+class Analysis:
+
+    def __init__(self, frames, calls, indirect, extern):
+        self.frames = frames
+        self.calls = calls
+        self.indirect = indirect
+        self.extern = extern
+        self.unknown = set()
+        self.worst = {}
+
+    def targets(self, function, active):
+        """Ritorna le funzioni chiamate da [function] e se ne ha saltate."""
+        callees, skipped = [], False
+        for callee in self.calls.get(function, []):
+            if callee != INDIRECT:
+                callees.append(callee)
+            elif function in self.indirect:
+                for target in self.indirect[function]:
+                    if target in active:
+                        skipped = True
+                    else:
+                        callees.append(target)
+            else:
+                callees.append(INDIRECT + " in " + function)
+        return callees, skipped
+
+    def usage(self, function, active=()):
+        """Ritorna lo stack usato da [function], il cammino peggiore e
+        se il risultato dipende da [active]."""
+        if function in self.worst:
+            return self.worst[function] + (False,)
+        if function in active and function not in self.indirect:
+            raise RecursionError(" -> ".join(active + (function,)))
+        if function not in self.frames:
+            self.unknown.add(function)
+            return self.extern, [function], False
+
+        partial = function in active
+        active = active + (function,)
+        callees, skipped = self.targets(function, active)
+        partial = partial or skipped
+        deepest, path = 0, []
+        for callee in callees:
+            used, callee_path, callee_partial = self.usage(callee, active)
+            partial = partial or callee_partial
+            if used > deepest:
+                deepest, path = used, callee_path
+
+        result = (self.frames[function] + deepest, [function] + path)
+        if not partial:
+            self.worst[function] = result
+        return result + (partial,)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("paths", nargs="+", help="file .ci o cartelle che li contengono")
+    parser.add_argument("--root", action="append", required=True)
+    parser.add_argument("--indirect", action="append", default=[])
+    parser.add_argument("--extern", type=int, default=0)
+    args = parser.parse_args()
+
+    files = []
+    for path in args.paths:
+        if os.path.isdir(path):
+            for base, _, names in os.walk(path):
+                files += [os.path.join(base, n) for n in names if n.endswith(".ci")]
+        else:
+            files.append(path)
+    frames, qualifiers, calls = read_graphs(files)
+
+    indirect = {}
+    for mapping in args.indirect:
+        caller, _, callees = mapping.partition("=")
+        targets = [t for name in callees.split(",") for t in find(frames, name)]
+        for function in find(frames, caller):
+            indirect.setdefault(function, []).extend(targets)
+    analysis = Analysis(frames, calls, indirect, args.extern)
+
+    status = 0
+    for name in args.root:
+        roots = find(frames, name)
+        if not roots:
+            print("%s: not found" % name, file=sys.stderr)
+            status = 1
+        for root in roots:
+            try:
+                used, path, _ = analysis.usage(root)
+            except RecursionError as e:
+                print("%s: recursive call %s" % (root, e), file=sys.stderr)
+                status = 1
+                continue
+            print("%s: %d bytes" % (root, used))
+            for function in path:
+                print("    %6d  %s" % (frames.get(function, args.extern), function))
+
+    unbounded = sorted(f for f, q in qualifiers.items()
+                       if "dynamic" in q and "bounded" not in q)
+    if unbounded:
+        print("unbounded frames: " + ", ".join(unbounded), file=sys.stderr)
+        status = 1
+    if analysis.unknown:
+        print("without call graph (%d bytes each): %s"
+              % (args.extern, ", ".join(sorted(analysis.unknown))))
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
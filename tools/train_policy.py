@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""
+Addestra la politica del giocatore artificiale di joystick_policy.c
+giocando partite tra copie di se stessa, poi la quantizza ad int8 e
+la scrive come array C in policy_weights.c.
+
+La rete ha un livello nascosto con ReLU:
+
+    hidden = relu(W1 * input + b1) >> policy_hidden_shift
+    output = W2 * hidden + b2
+
+Gli ingressi (vedi [features]) sono calcolati esattamente come in
+joystick_policy.c e le uscite sono i punteggi delle tre mosse
+(sinistra, dritto, destra) relative alla direzione del serpente. Le
+mosse che farebbero perdere al prossimo update sono scartate prima
+di scegliere quella col punteggio più alto.
+
+L'addestramento usa una strategia evolutiva (gradiente stimato con
+perturbazioni gaussiane antitetiche), quindi serve solo la libreria
+standard di Python. Il simulatore segue le regole di game.c: griglia
+toroidale, serpenti aggiornati in ordine di giocatore, una sola mela.
+
+Uso:
+
+    python3 tools/train_policy.py [--generations N] [--seed S] [-o policy_weights.c]
+"""
+
+import argparse
+import math
+import random
+from collections import deque
+
+WIDTH, HEIGHT = 32, 16
+CELLS = WIDTH * HEIGHT
+
+# Devono coincidere con policy_weights.h.
+WINDOW = 2                      # Raggio della finestra attorno alla testa
+WINDOW_INPUTS = (2 * WINDOW + 1) ** 2 - 1
+POLICY_INPUTS = 28              # WINDOW_INPUTS + 3 ingressi mela + padding
+POLICY_HIDDEN = 8
+POLICY_OUTPUTS = 3
+INPUT_ONE = 64                  # Valore intero di un ingresso uguale ad 1
+
+LEFT, RIGHT, UP, DOWN = range(4)
+TURN_LEFT = {UP: LEFT, LEFT: DOWN, DOWN: RIGHT, RIGHT: UP}
+TURN_RIGHT = {UP: RIGHT, RIGHT: DOWN, DOWN: LEFT, LEFT: UP}
+VECTORS = {LEFT: (-1, 0), RIGHT: (1, 0), UP: (0, -1), DOWN: (0, 1)}
+UNREACHABLE = 0xFFFF
+
+
+def neighbour(idx, d):
+    x, y = idx % WIDTH, idx // WIDTH
+    dx, dy = VECTORS[d]
+    return ((y + dy) % HEIGHT) * WIDTH + (x + dx) % WIDTH
+
+
+def action_directions(d):
+    """Direzioni assolute delle mosse sinistra, dritto e destra."""
+    return (TURN_LEFT[d], d, TURN_RIGHT[d])
+
+
+class Snake:
+    def __init__(self, x, y):
+        self.body = deque([(y % HEIGHT) * WIDTH + x % WIDTH])  # Testa a sinistra
+        self.dir = LEFT
+        self.grow = False
+        self.alive = True
+        self.apples = 0
+        self.ticks = 0
+
+
+class World:
+    """Equivalente di WorldModel in world.c."""
+
+    def __init__(self, snakes, apple):
+        self.free_in = [0] * CELLS
+        self.predicted = [-1] * len(snakes)
+        self.moving_tail = [-1] * len(snakes)
+        for i, s in enumerate(snakes):
+            if not s.alive:
+                continue
+            blocked_size = len(s.body) - (0 if s.grow else 1)
+            for j, c in enumerate(s.body):
+                self.free_in[c] = max(self.free_in[c], blocked_size - j + 1)
+            if not s.grow:
+                self.moving_tail[i] = s.body[-1]
+            self.predicted[i] = neighbour(s.body[0], s.dir)
+
+        self.safe = [0] * len(snakes)
+        for i, s in enumerate(snakes):
+            if not s.alive:
+                continue
+            for d in range(4):
+                n = neighbour(s.body[0], d)
+                if self.free_in[n] > 1:
+                    continue
+                if any(j != i and self.predicted[j] == n for j in range(len(snakes))):
+                    continue
+                if any(self.moving_tail[j] == n for j in range(i + 1, len(snakes))):
+                    continue
+                self.safe[i] |= 1 << d
+
+        self.apple_distance = [UNREACHABLE] * CELLS
+        self.apple_distance[apple] = 0
+        queue = deque([apple])
+        while queue:
+            c = queue.popleft()
+            for d in range(4):
+                n = neighbour(c, d)
+                if self.apple_distance[n] == UNREACHABLE and self.free_in[n] <= 1:
+                    self.apple_distance[n] = self.apple_distance[c] + 1
+                    queue.append(n)
+
+
+def features(world, snake, player):
+    """Ingressi della rete, come [computeFeatures] in joystick_policy.c."""
+    head = snake.body[0]
+    hx, hy = head % WIDTH, head // WIDTH
+    fx, fy = VECTORS[snake.dir]
+    rx, ry = VECTORS[TURN_RIGHT[snake.dir]]
+
+    inputs = []
+    for f in range(WINDOW, -WINDOW - 1, -1):
+        for r in range(-WINDOW, WINDOW + 1):
+            if f == 0 and r == 0:
+                continue
+            x = (hx + f * fx + r * rx) % WIDTH
+            y = (hy + f * fy + r * ry) % HEIGHT
+            c = y * WIDTH + x
+            occupied = world.free_in[c] > 1 or any(
+                j != player and world.predicted[j] == c for j in range(len(world.predicted)))
+            inputs.append(INPUT_ONE if occupied else 0)
+
+    distances = [world.apple_distance[neighbour(head, d)] for d in action_directions(snake.dir)]
+    best = min(distances)
+    for there in distances:
+        if there == UNREACHABLE:
+            inputs.append(-INPUT_ONE)
+        else:
+            inputs.append(INPUT_ONE if there == best else 0)
+
+    inputs += [0] * (POLICY_INPUTS - len(inputs))
+    return inputs
+
+
+class FloatPolicy:
+    """Rete con pesi reali, usata durante l'addestramento."""
+
+    SIZE = POLICY_HIDDEN * POLICY_INPUTS + POLICY_HIDDEN + POLICY_OUTPUTS * POLICY_HIDDEN + POLICY_OUTPUTS
+
+    def __init__(self, params):
+        p = iter(params)
+        self.w1 = [[next(p) for _ in range(POLICY_INPUTS)] for _ in range(POLICY_HIDDEN)]
+        self.b1 = [next(p) for _ in range(POLICY_HIDDEN)]
+        self.w2 = [[next(p) for _ in range(POLICY_HIDDEN)] for _ in range(POLICY_OUTPUTS)]
+        self.b2 = [next(p) for _ in range(POLICY_OUTPUTS)]
+
+    def scores(self, inputs):
+        x = [v / INPUT_ONE for v in inputs]
+        hidden = [max(0.0, sum(w * v for w, v in zip(row, x)) + b)
+                  for row, b in zip(self.w1, self.b1)]
+        return [sum(w * h for w, h in zip(row, hidden)) + b
+                for row, b in zip(self.w2, self.b2)]
+
+
+class QuantizedPolicy:
+    """Rete quantizzata, identica all'inferenza di joystick_policy.c."""
+
+    def __init__(self, float_policy, samples):
+        fp = float_policy
+        # W1 e b1 sono scalati per [s1]: con ingressi moltiplicati per
+        # INPUT_ONE l'accumulatore vale (s1 * INPUT_ONE) volte il valore reale.
+        s1 = 127 / max(1e-9, max(abs(w) for row in fp.w1 for w in row))
+        self.w1 = [[clamp8(round(w * s1)) for w in row] for row in fp.w1]
+        self.b1 = [round(b * s1 * INPUT_ONE) for b in fp.b1]
+
+        # Lo shift riporta i valori nascosti osservati nell'intervallo int8.
+        peak = 1
+        for inputs in samples:
+            for h in self.hidden_acc(inputs):
+                peak = max(peak, h)
+        self.shift = 0
+        while (peak >> self.shift) > 127:
+            self.shift += 1
+        hidden_scale = s1 * INPUT_ONE / (1 << self.shift)
+
+        s2 = 127 / max(1e-9, max(abs(w) for row in fp.w2 for w in row))
+        self.w2 = [[clamp8(round(w * s2)) for w in row] for row in fp.w2]
+        self.b2 = [round(b * s2 * hidden_scale) for b in fp.b2]
+
+    def hidden_acc(self, inputs):
+        return [max(0, sum(w * v for w, v in zip(row, inputs)) + b)
+                for row, b in zip(self.w1, self.b1)]
+
+    def scores(self, inputs):
+        hidden = [min(127, h >> self.shift) for h in self.hidden_acc(inputs)]
+        return [sum(w * h for w, h in zip(row, hidden)) + b
+                for row, b in zip(self.w2, self.b2)]
+
+
+def clamp8(v):
+    return max(-127, min(127, v))
+
+
+def choose(policy, world, snake, player):
+    """Sceglie la direzione come [getButton] in joystick_policy.c."""
+    scores = policy.scores(features(world, snake, player))
+    best, best_score = snake.dir, None
+    for a, d in enumerate(action_directions(snake.dir)):
+        if not (world.safe[player] >> d) & 1:
+            continue
+        if best_score is None or scores[a] > best_score:
+            best, best_score = d, scores[a]
+    return best
+
+
+def play(policies, seed, tick_limit=600, samples=None):
+    """Gioca una partita e ritorna i serpenti alla fine."""
+    rng = random.Random(seed)
+    snakes = [Snake(rng.randrange(WIDTH), rng.randrange(HEIGHT)) for _ in policies]
+
+    def spawn_apple():
+        occupied = {c for s in snakes if s.alive for c in s.body}
+        while True:
+            c = rng.randrange(CELLS)
+            if c not in occupied:
+                return c
+
+    apple = spawn_apple()
+    for tick in range(tick_limit):
+        world = World(snakes, apple)
+        for i, s in enumerate(snakes):
+            if s.alive:
+                if samples is not None and rng.random() < 0.05:
+                    samples.append(features(world, s, i))
+                s.dir = choose(policies[i], world, s, i)
+
+        for i, s in enumerate(snakes):
+            if not s.alive:
+                continue
+            head = neighbour(s.body[0], s.dir)
+            s.body.appendleft(head)
+            if s.grow:
+                s.grow = False
+            else:
+                s.body.pop()
+            s.ticks += 1
+            if head == apple:
+                s.grow = True
+                s.apples += 1
+                apple = spawn_apple()
+            for j, o in enumerate(snakes):
+                if not o.alive:
+                    continue
+                body = list(o.body)[1:] if o is s else o.body
+                if head in body:
+                    s.alive = False
+                    break
+
+        if sum(s.alive for s in snakes) <= (0 if len(snakes) == 1 else 1):
+            break
+    return snakes
+
+
+def fitness(params, opponent, seeds):
+    policy = FloatPolicy(params)
+    total = 0.0
+    for seed in seeds:
+        snakes = play([policy, opponent], seed)
+        me, other = snakes
+        total += me.ticks + 20 * me.apples + (200 if me.alive and not other.alive else 0)
+    return total / len(seeds)
+
+
+def train(generations, seed, population=8, sigma=0.1, rate=0.05, games=3):
+    rng = random.Random(seed)
+    theta = [rng.gauss(0, 0.1) for _ in range(FloatPolicy.SIZE)]
+
+    for gen in range(generations):
+        opponent = FloatPolicy(theta)
+        seeds = [rng.randrange(1 << 30) for _ in range(games)]
+        gradient = [0.0] * len(theta)
+        results = []
+        for _ in range(population):
+            eps = [rng.gauss(0, 1) for _ in theta]
+            plus = fitness([t + sigma * e for t, e in zip(theta, eps)], opponent, seeds)
+            minus = fitness([t - sigma * e for t, e in zip(theta, eps)], opponent, seeds)
+            results.append((plus, minus))
+            for k, e in enumerate(eps):
+                gradient[k] += (plus - minus) * e
+
+        spread = math.sqrt(sum((p - m) ** 2 for p, m in results) / len(results)) or 1.0
+        for k in range(len(theta)):
+            theta[k] += rate * gradient[k] / (population * sigma * spread)
+
+        mean = sum(p + m for p, m in results) / (2 * len(results))
+        print("generation %d: mean fitness %.1f" % (gen, mean), flush=True)
+    return theta
+
+
+def write_c(path, q, header):
+    def array(rows):
+        return ",\n".join("  { " + ", ".join("%4d" % v for v in row) + " }" for row in rows)
+
+    with open(path, "w", encoding="latin-1") as f:
+        f.write("/* Generato da tools/train_policy.py (%s).\n" % header)
+        f.write(" * Non modificare a mano: rigenerare con lo script.\n */\n")
+        f.write('#include "policy_weights.h"\n\n')
+        f.write("const int8_t policy_w1[POLICY_HIDDEN][POLICY_INPUTS] = {\n%s\n};\n\n" % array(q.w1))
+        f.write("const int32_t policy_b1[POLICY_HIDDEN] = { %s };\n\n" % ", ".join(str(v) for v in q.b1))
+        f.write("const int8_t policy_w2[POLICY_OUTPUTS][POLICY_HIDDEN] = {\n%s\n};\n\n" % array(q.w2))
+        f.write("const int32_t policy_b2[POLICY_OUTPUTS] = { %s };\n\n" % ", ".join(str(v) for v in q.b2))
+        f.write("const unsigned int policy_hidden_shift = %d;\n" % q.shift)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--generations", type=int, default=40)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-o", "--output", default="policy_weights.c")
+    args = parser.parse_args()
+
+    theta = train(args.generations, args.seed)
+    policy = FloatPolicy(theta)
+
+    samples = []
+    for s in range(10):
+        play([policy, policy], 1000 + s, samples=samples)
+    q = QuantizedPolicy(policy, samples)
+
+    agree = sum(max(range(3), key=lambda a: policy.scores(x)[a]) ==
+                max(range(3), key=lambda a: q.scores(x)[a]) for x in samples)
+    print("quantized policy agrees on %d/%d sampled states" % (agree, len(samples)))
+
+    write_c(args.output, q, "seed %d, %d generazioni" % (args.seed, args.generations))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1002 @@
+#include <stdint.h>
+#include <string.h>
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include "game.h"
+#include "config.h"
+#include "display.h"
+#include "joystick.h"
+#include "tournament.h"
+#include "transposition.h"
+#include "budget.h"
+#include "ssd1306.h"
+#include "assets.h"
+
+/* Symbol: Tournament
+ *   Fa giocare tra loro i giocatori artificiali in partite
+ *   senza grafica né attese (vedi [Game_setHeadless]) e con
+ *   un seme diverso per ogni partita, così che i risultati
+ *   siano riproducibili. Per ogni giocatore di ogni serie
+ *   vengono stampate sulla seriale, in formato CSV, le
+ *   percentuali di vittoria, la sopravvivenza media, le
+ *   mele mangiate e la latenza media e al 99° percentile
+ *   delle decisioni. Per ogni serie viene stampato anche
+ *   il numero di tick al secondo.
+ *
+ *   Il modello del mondo (vedi [Game_getWorldModel]) è
+ *   costruito una volta per tick da chi lo chiede per primo,
+ *   quindi è costruito prima di chiedere la mossa al primo
+ *   giocatore e non viene contato nella sua latenza: il suo
+ *   costo medio e al 99° percentile sono stampati a parte.
+ *
+ *   Dopo i risultati di ogni serie è stampato un commento con
+ *   lo XOR degli hash finali delle partite (vedi [Game_getHash])
+ *   e la percentuale di successo della tabella delle
+ *   trasposizioni. Se una modifica cambia l'hash di una serie
+ *   senza volerlo, una delle partite è andata diversamente:
+ *   confrontando [Game_getHash] tick per tick si trova dove.
+ *
+ *   Nelle serie con [frame_budget_us] tutti i giocatori si
+ *   dividono un [AIBudget] e per ognuno sono stampati il
+ *   numero e la percentuale di decisioni che hanno sforato
+ *   la propria parte, e per i giocatori di tipo
+ *   PlayerKind_SEARCH la profondità media raggiunta. Gli
+ *   altri giocatori non si possono interrompere, quindi è
+ *   [TimedJoystick] a registrarli ed a misurarli. Se la
+ *   ricerca viene interrotta queste serie dipendono dai
+ *   tempi, quindi il loro hash può cambiare tra due run.
+ *
+ *   Ogni giocatore può avere una baseline: se il giocatore
+ *   vince meno, sopravvive meno, decide più lentamente o
+ *   sfora più spesso la sua parte del frame di quanto
+ *   indicato nella baseline, la serie fallisce e
+ *   [Tournament_run] ritorna 0. Questo permette di capire se
+ *   una modifica ad un'IA la peggiora senza dover giocare
+ *   sulla scheda.
+ *
+ *   Le serie con [draw] disegnano ogni frame come sulla
+ *   scheda e misurano quanti byte vengono inviati al display
+ *   (vedi [Display_getBytesSent]).
+ *
+ *   Prima delle serie vengono controllati gli aggiornamenti
+ *   parziali del display (vedi [Tournament_checkDisplay]) e
+ *   viene stampato il costo in cicli di
+ *   clock dei generatori di numeri casuali e del disegno
+ *   (vedi [Tournament_benchmarkRandom] e
+ *   [Tournament_benchmarkDisplay]).
+ *
+ *   Con [Tournament_runChecks] e [Tournament_runSeries] si
+ *   possono eseguire i controlli e le singole serie
+ *   separatamente: sull'host tools/host/run_tournament.py
+ *   le gioca così in parallelo, un processo per serie, e
+ *   raccoglie i risultati in JSON.
+ *
+ * Nota: La scheda ha un solo core, quindi le partite sono
+ *       giocate in sequenza. I giocatori artificiali sono
+ *       sincroni, altrimenti i risultati dipenderebbero
+ *       dallo scheduling dei thread.
+ */
+
+typedef enum {
+  PlayerKind_AI,
+  PlayerKind_RANDOM,
+  PlayerKind_HAMILTON,
+  PlayerKind_RANDOM_SAFE,
+  PlayerKind_SEARCH,
+  PlayerKind_PATH,
+  PlayerKind_POLICY,
+} PlayerKind;
+
+static const char *player_kind_names[] = {
+  [PlayerKind_AI]          = "ai",
+  [PlayerKind_RANDOM]      = "random",
+  [PlayerKind_HAMILTON]    = "hamilton",
+  [PlayerKind_RANDOM_SAFE] = "random_safe",
+  [PlayerKind_SEARCH]      = "search",
+  [PlayerKind_PATH]        = "path",
+  [PlayerKind_POLICY]      = "policy",
+};
+
+/* Symbol: TournamentBaseline
+ *   Valori minimi (o massimi per la latenza) che un giocatore
+ *   deve rispettare. I campi a 0 non sono controllati.
+ */
+typedef struct {
+  unsigned int min_win_rate;      // Percentuale
+  unsigned int min_avg_survival;  // Tick
+  unsigned int max_p99_us;        // Microsecondi
+  unsigned int max_overrun_rate;  // Millesimi delle decisioni
+} TournamentBaseline;
+
+typedef struct {
+  const char  *name;
+  unsigned int games;
+  unsigned int tick_limit;
+  int          seed;
+  int          player_count;
+
+  // Pixel del display per cella della griglia (0 per
+  // lasciare quella impostata da main).
+  unsigned int resolution;
+
+  // Budget per frame dei giocatori PlayerKind_SEARCH
+  // (0 se la ricerca arriva sempre ad AI_SEARCH_DEPTH).
+  uint32_t     frame_budget_us;
+
+  // Se [draw] è 1 le partite sono disegnate come sulla scheda
+  // e viene stampato il numero medio di byte inviati al
+  // display per frame. La serie fallisce se supera
+  // [max_frame_bytes] (se diverso da 0).
+  _Bool        draw;
+  unsigned int max_frame_bytes;
+
+  PlayerKind         players[MAX_PLAYERS_PER_GAME];
+  TournamentBaseline baselines[MAX_PLAYERS_PER_GAME];
+} TournamentSeries;
+
+static const TournamentSeries series[] = {
+  {
+    .name = "royale",
+    .games = 50,
+    .tick_limit = 2000,
+    .seed = 69420,
+    .player_count = 4,
+    .players   = { PlayerKind_AI, PlayerKind_AI, PlayerKind_RANDOM, PlayerKind_RANDOM },
+    .baselines = { { .min_win_rate = 22, .max_p99_us = 2000 }, { .min_win_rate = 32, .max_p99_us = 2000 },
+                   { .min_avg_survival = 103 }, { .min_avg_survival = 118 } },
+  },
+  {
+    .name = "ai_vs_random",
+    .games = 50,
+    .tick_limit = 2000,
+    .seed = 10000,
+    .player_count = 2,
+    .players   = { PlayerKind_AI, PlayerKind_RANDOM },
+    .baselines = { { .min_win_rate = 90, .max_p99_us = 2000 }, { .min_avg_survival = 146 } },
+  },
+  {
+    .name = "royale_safe_random",
+    .games = 20,
+    .tick_limit = 2000,
+    .seed = 4242,
+    .player_count = 6,
+    .players   = { PlayerKind_AI, PlayerKind_AI, PlayerKind_RANDOM_SAFE,
+                   PlayerKind_RANDOM_SAFE, PlayerKind_RANDOM_SAFE, PlayerKind_RANDOM_SAFE },
+    .baselines = { { .min_win_rate = 5, .max_p99_us = 2000 }, { .min_win_rate = 20, .max_p99_us = 2000 },
+                   { .min_avg_survival = 1127 }, { .min_avg_survival = 1011 },
+                   { .min_avg_survival = 843 }, { .min_avg_survival = 668 } },
+  },
+  {
+    .name = "search_vs_ai",
+    .games = 20,
+    .tick_limit = 2000,
+    .seed = 777,
+    .player_count = 2,
+    .players   = { PlayerKind_SEARCH, PlayerKind_AI },
+    .baselines = { { .min_win_rate = 50, .max_p99_us = 5000 }, { .min_win_rate = 5, .max_p99_us = 2000 } },
+  },
+  {
+    // Le parti del frame sono AI_FRAME_BUDGET_US diviso per
+    // il numero di giocatori: con 4 la ricerca arriva meno
+    // a fondo che con 2 (vedi la profondità media stampata).
+    // Qui la ricerca viene interrotta e le partite dipendono
+    // dai tempi: la sopravvivenza minima è la più bassa
+    // misurata in quattro run, arrotondata per difetto, e le
+    // decisioni possono sforare al più l'1% delle volte.
+    .name = "search_budget_2",
+    .games = 10,
+    .tick_limit = 2000,
+    .seed = 8080,
+    .player_count = 2,
+    .frame_budget_us = AI_FRAME_BUDGET_US,
+    .players   = { PlayerKind_SEARCH, PlayerKind_SEARCH },
+    .baselines = { { .min_avg_survival = 1900, .max_p99_us = AI_FRAME_BUDGET_US / 2,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1900, .max_p99_us = AI_FRAME_BUDGET_US / 2,
+                     .max_overrun_rate = 10 } },
+  },
+  {
+    // Come search_budget_2.
+    .name = "search_budget_4",
+    .games = 10,
+    .tick_limit = 2000,
+    .seed = 8080,
+    .player_count = 4,
+    .frame_budget_us = AI_FRAME_BUDGET_US,
+    .players   = { PlayerKind_SEARCH, PlayerKind_SEARCH, PlayerKind_SEARCH, PlayerKind_SEARCH },
+    .baselines = { { .min_avg_survival = 1600, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1600, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1600, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1600, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 } },
+  },
+  {
+    // Come search_budget_2. Gli altri giocatori non si
+    // interrompono, ma hanno la loro parte del frame e
+    // devono starci dentro.
+    .name = "search_budget_mixed",
+    .games = 10,
+    .tick_limit = 2000,
+    .seed = 8080,
+    .player_count = 4,
+    .frame_budget_us = AI_FRAME_BUDGET_US,
+    .players   = { PlayerKind_SEARCH, PlayerKind_AI, PlayerKind_PATH, PlayerKind_POLICY },
+    .baselines = { { .min_avg_survival = 1400, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1200, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 1200, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 },
+                   { .min_avg_survival = 600, .max_p99_us = AI_FRAME_BUDGET_US / 4,
+                     .max_overrun_rate = 10 } },
+  },
+  {
+    .name = "path_vs_ai",
+    .games = 20,
+    .tick_limit = 2000,
+    .seed = 31337,
+    .player_count = 2,
+    .players   = { PlayerKind_PATH, PlayerKind_AI },
+    // Con i giocatori scambiati il percorso vince il 70%
+    // delle partite: il divario viene dall'ordine di gioco.
+    .baselines = { { .min_win_rate = 20, .min_avg_survival = 1450, .max_p99_us = 2000 },
+                   { .min_win_rate = 65, .max_p99_us = 2000 } },
+  },
+  {
+    .name = "policy_vs_ai",
+    .games = 20,
+    .tick_limit = 2000,
+    .seed = 2718,
+    .player_count = 2,
+    .players   = { PlayerKind_POLICY, PlayerKind_AI },
+    // La politica sopravvive a lungo ma mangia poco: vince
+    // una partita su 20, le altre finiscono col limite di
+    // tick o con la vittoria dell'IA.
+    .baselines = { { .min_win_rate = 5, .min_avg_survival = 1349, .max_p99_us = 2000 },
+                   { .min_win_rate = 50, .max_p99_us = 2000 } },
+  },
+  {
+    .name = "display",
+    .games = 5,
+    .tick_limit = 500,
+    .seed = 5150,
+    .player_count = 4,
+    .draw = 1,
+    .max_frame_bytes = 100,
+    .players   = { PlayerKind_AI, PlayerKind_AI, PlayerKind_AI, PlayerKind_AI },
+    .baselines = { { .min_avg_survival = 500, .max_p99_us = 2000 },
+                   { .min_avg_survival = 500, .max_p99_us = 2000 },
+                   { .min_avg_survival = 500, .max_p99_us = 2000 },
+                   { .min_avg_survival = 434, .max_p99_us = 2000 } },
+  },
+  {
+    // Su una griglia 8x4 le celle libere sono poche fin
+    // dall'inizio, quindi il risolutore del finale decide
+    // quasi ogni mossa del serpente rimasto solo.
+    .name = "endgame_ai",
+    .games = 10,
+    .tick_limit = 5000,
+    .seed = 2024,
+    .player_count = 1,
+    .resolution = 16,
+    .players   = { PlayerKind_AI },
+    .baselines = { { .min_avg_survival = 5000, .max_p99_us = 2000 } },
+  },
+  {
+    .name = "endgame_search",
+    .games = 10,
+    .tick_limit = 5000,
+    .seed = 2024,
+    .player_count = 1,
+    .resolution = 16,
+    .players   = { PlayerKind_SEARCH },
+    .baselines = { { .min_win_rate = 30, .max_p99_us = 5000 } },
+  },
+  {
+    .name = "classic_hamilton",
+    .games = 2,
+    .tick_limit = 200000,
+    .seed = 1234,
+    .player_count = 1,
+    .players   = { PlayerKind_HAMILTON },
+    .baselines = { { .min_win_rate = 100, .max_p99_us = 100 } },
+  },
+};
+
+/* Symbol: LatencyHistogram
+ *   Istogramma delle latenze (in cicli di clock) con bucket
+ *   log-lineari: ogni potenza di 2 è divisa in 4 bucket, quindi
+ *   l'errore sul percentile è al più del 25%. Permette di
+ *   calcolare il 99° percentile senza salvare ogni campione.
+ */
+#define LATENCY_BUCKETS 128
+
+typedef struct {
+  uint32_t counts[LATENCY_BUCKETS];
+  uint32_t total;
+  uint64_t sum;
+} LatencyHistogram;
+
+static unsigned int latencyBucket(uint32_t cycles)
+{
+  if (cycles < 4)
+    return cycles;
+  unsigned int log = 31 - __builtin_clz(cycles);
+  return log * 4 + ((cycles >> (log - 2)) & 3);
+}
+
+static uint32_t latencyBucketUpperBound(unsigned int bucket)
+{
+  if (bucket < 4)
+    return bucket;
+  unsigned int log = bucket / 4;
+  unsigned int sub = bucket % 4;
+  return (((uint64_t) 5 + sub) << (log - 2)) - 1;
+}
+
+static void LatencyHistogram_add(LatencyHistogram *hist, uint32_t cycles)
+{
+  hist->counts[latencyBucket(cycles)]++;
+  hist->total++;
+  hist->sum += cycles;
+}
+
+static uint32_t LatencyHistogram_percentile(const LatencyHistogram *hist,
+                                            unsigned int percent)
+{
+  uint32_t threshold = (hist->total * (uint64_t) percent + 99) / 100;
+  uint32_t cumulative = 0;
+  for (unsigned int i = 0; i < LATENCY_BUCKETS; ++i) {
+    cumulative += hist->counts[i];
+    if (cumulative >= threshold && cumulative > 0)
+      return latencyBucketUpperBound(i);
+  }
+  return 0;
+}
+
+typedef struct {
+  unsigned int wins;
+  unsigned int survival_ticks;
+  unsigned int apples;
+  unsigned int replans;  // Solo per PlayerKind_PATH
+  unsigned int repairs;
+  unsigned int depth_sum;  // Solo per PlayerKind_SEARCH
+  unsigned int decisions;
+  unsigned int overruns;  // Solo nelle serie con [frame_budget_us]
+  LatencyHistogram latency;
+} PlayerStats;
+
+/* Symbol: TimedJoystick
+ *   Joystick che inoltra le richieste ad un altro joystick
+ *   misurando quanto tempo impiega a rispondere. Se nel
+ *   tick corrente il modello del mondo non è ancora stato
+ *   costruito, lo costruisce prima e ne misura il tempo
+ *   in [world_latency].
+ *
+ *   Se [budget_bot] non è -1 la decisione è contata anche
+ *   come parte [budget_bot] di [budget], per i giocatori
+ *   che non lo usano da soli.
+ */
+typedef struct {
+  Joystick     base;
+  Joystick    *inner;
+  Game        *game;
+  PlayerStats *stats;
+  int          budget_bot;
+} TimedJoystick;
+
+typedef union {
+  AIJoystick       ai;
+  RandomJoystick   random;
+  HamiltonJoystick hamilton;
+  SearchJoystick   search;
+  PathJoystick     path;
+  PolicyJoystick   policy;
+} AnyJoystick;
+
+static PlayerStats   stats[MAX_PLAYERS_PER_GAME];
+static LatencyHistogram world_latency;
+static AnyJoystick   joysticks[MAX_PLAYERS_PER_GAME];
+static TimedJoystick timed_joysticks[MAX_PLAYERS_PER_GAME];
+
+// Condivisa dai giocatori di tipo PlayerKind_SEARCH.
+static TranspositionTable transpositions;
+
+// Condiviso da tutti i giocatori nelle serie con
+// [frame_budget_us].
+static AIBudget budget;
+
+// Il tick (più uno) in cui è stato costruito l'ultimo modello
+// del mondo, oppure 0 se non è stato costruito nella partita
+// corrente.
+static unsigned int world_built_at;
+
+static BaseSequentialStream *out = (BaseSequentialStream*) &SD2;
+
+static Button TimedJoystick_getButton(Joystick *joystick, int player)
+{
+  TimedJoystick *timed = (TimedJoystick*) joystick;
+
+  unsigned int ticks = Game_getTicks(timed->game);
+  if (world_built_at != ticks + 1) {
+    rtcnt_t start = chSysGetRealtimeCounterX();
+    Game_getWorldModel(timed->game);
+    LatencyHistogram_add(&world_latency, chSysGetRealtimeCounterX() - start);
+    world_built_at = ticks + 1;
+  }
+
+  if (timed->budget_bot >= 0)
+    AIBudget_begin(&budget, timed->budget_bot);
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  Button button = Joystick_getButton(timed->inner, player);
+  LatencyHistogram_add(&timed->stats->latency, chSysGetRealtimeCounterX() - start);
+
+  if (timed->budget_bot >= 0)
+    AIBudget_end(&budget, timed->budget_bot);
+  return button;
+}
+
+static JoystickMethodTable timed_table = {
+  .getButton = TimedJoystick_getButton,
+  .free = 0,
+};
+
+static Joystick *createJoystick(PlayerKind kind, AnyJoystick *joystick, Game *game,
+                                _Bool budgeted)
+{
+  switch (kind) {
+  case PlayerKind_AI:       AIJoystick_init(&joystick->ai, game); break;
+  case PlayerKind_RANDOM:   RandomJoystick_init(&joystick->random); break;
+  case PlayerKind_HAMILTON: HamiltonJoystick_init(&joystick->hamilton, game); break;
+  case PlayerKind_RANDOM_SAFE:
+    RandomJoystick_initSafe(&joystick->random, game, generateRandomInteger());
+    break;
+  case PlayerKind_SEARCH:
+    SearchJoystick_init(&joystick->search, game, &transpositions);
+    if (budgeted && !SearchJoystick_setBudget(&joystick->search, &budget))
+      return 0;
+    break;
+  case PlayerKind_POLICY:
+    PolicyJoystick_init(&joystick->policy, game);
+    break;
+  case PlayerKind_PATH:
+    if (!PathJoystick_init(&joystick->path, game))
+      return 0;
+    break;
+  }
+  return (Joystick*) joystick;
+}
+
+static uint32_t cyclesToMicroseconds(uint32_t cycles)
+{
+  return cycles / (STM32_HCLK / 1000000);
+}
+
+/* Symbol: Tournament_playSeries
+ *   Gioca tutte le partite di una serie e ne stampa i
+ *   risultati. Ritorna 1 se ogni giocatore ha rispettato
+ *   la propria baseline.
+ */
+static _Bool Tournament_playSeries(const TournamentSeries *s)
+{
+  // Con -O0 un letterale composto finirebbe sullo stack,
+  // ed un [PlayerStats] è grande più di metà dello stack
+  // del processo principale.
+  memset(stats, 0, s->player_count * sizeof(stats[0]));
+  memset(&world_latency, 0, sizeof(world_latency));
+
+  TranspositionTable_clear(&transpositions);
+
+  unsigned int total_ticks = 0;
+  uint32_t hash = 0;
+  unsigned int display_bytes = Display_getBytesSent();
+  unsigned int display_transfers = Display_getTransfers();
+  unsigned int display_wait_us = Display_getWaitMicroseconds();
+  systime_t start = chVTGetSystemTimeX();
+
+  for (unsigned int g = 0; g < s->games; ++g) {
+
+    setSeed(s->seed + g);
+
+    // Le partite disegnate aspettano 1 ms per frame.
+    Game *game = Game_new(s->draw ? 1000 : 1);
+    if (game == 0) {
+      chprintf(out, "# %s: couldn't create game\r\n", s->name);
+      return 0;
+    }
+    Game_setHeadless(game, !s->draw);
+    Game_setTickLimit(game, s->tick_limit);
+    AIBudget_init(&budget, s->frame_budget_us);
+    world_built_at = 0;
+
+    for (int i = 0; i < s->player_count; ++i) {
+      TimedJoystick *timed = &timed_joysticks[i];
+      timed->base.table = &timed_table;
+      timed->inner = createJoystick(s->players[i], &joysticks[i], game,
+                                    s->frame_budget_us > 0);
+      timed->game = game;
+      timed->stats = &stats[i];
+      timed->budget_bot = -1;
+      if (timed->inner != 0 && s->frame_budget_us > 0 && s->players[i] != PlayerKind_SEARCH) {
+        timed->budget_bot = AIBudget_register(&budget);
+        if (timed->budget_bot < 0) {
+          Joystick_free(timed->inner);
+          timed->inner = 0;
+        }
+      }
+      if (timed->inner == 0) {
+        chprintf(out, "# %s: couldn't create player %d\r\n", s->name, i);
+        for (int j = 0; j < i; ++j)
+          Joystick_free(timed_joysticks[j].inner);
+        Game_free(game);
+        return 0;
+      }
+      Game_plugJoystick(game, (Joystick*) timed);
+    }
+
+    GameEvent event = Game_play(game);
+
+    for (int i = 0; i < s->player_count; ++i) {
+      if (s->players[i] == PlayerKind_PATH) {
+        stats[i].replans += PathJoystick_getReplans(&joysticks[i].path);
+        stats[i].repairs += PathJoystick_getRepairs(&joysticks[i].path);
+      }
+      if (s->players[i] == PlayerKind_SEARCH) {
+        stats[i].depth_sum += SearchJoystick_getDepthSum(&joysticks[i].search);
+        stats[i].decisions += SearchJoystick_getDecisions(&joysticks[i].search);
+        stats[i].overruns  += SearchJoystick_getOverruns(&joysticks[i].search);
+      }
+      if (timed_joysticks[i].budget_bot >= 0)
+        stats[i].overruns += AIBudget_getOverruns(&budget, timed_joysticks[i].budget_bot);
+      Joystick_free(timed_joysticks[i].inner);
+    }
+
+    if (event.type == GameEventType_ERROR) {
+      chprintf(out, "# %s: game %u failed\r\n", s->name, g);
+      Game_free(game);
+      return 0;
+    }
+
+    if (event.type == GameEventType_WIN)
+      stats[event.winner].wins++;
+
+    for (int i = 0; i < s->player_count; ++i) {
+      stats[i].survival_ticks += Game_getPlayerSurvivalTicks(game, i);
+      stats[i].apples += Game_getPlayerApples(game, i);
+    }
+    total_ticks += Game_getTicks(game);
+    hash ^= Game_getHash(game);
+
+    Game_free(game);
+  }
+
+  uint32_t elapsed_ms = TIME_I2MS(chVTTimeElapsedSinceX(start));
+  if (elapsed_ms == 0)
+    elapsed_ms = 1;
+
+  _Bool passed = 1;
+
+  if (s->draw) {
+    // Game_draw viene chiamato ad ogni tick.
+    unsigned int frames = total_ticks == 0 ? 1 : total_ticks;
+    unsigned int frame_bytes = (Display_getBytesSent() - display_bytes) / frames;
+    unsigned int frame_transfers = (Display_getTransfers() - display_transfers) * 10 / frames;
+    unsigned int frame_wait_us = (Display_getWaitMicroseconds() - display_wait_us) / frames;
+    passed = s->max_frame_bytes == 0 || frame_bytes <= s->max_frame_bytes;
+    chprintf(out, "# %s: %u display bytes in %u.%u transfers per frame, "
+                  "%u us per frame waiting for the display\r\n",
+             s->name, frame_bytes, frame_transfers / 10, frame_transfers % 10,
+             frame_wait_us);
+  }
+  for (int i = 0; i < s->player_count; ++i) {
+
+    const PlayerStats *st = &stats[i];
+    const TournamentBaseline *base = &s->baselines[i];
+
+    unsigned int win_rate = st->wins * 100 / s->games;
+    unsigned int avg_survival = st->survival_ticks / s->games;
+    uint32_t mean_us = st->latency.total == 0 ? 0
+                     : cyclesToMicroseconds(st->latency.sum / st->latency.total);
+    uint32_t p99_us = cyclesToMicroseconds(LatencyHistogram_percentile(&st->latency, 99));
+    unsigned int overrun_rate = st->latency.total == 0 ? 0
+                              : st->overruns * 1000 / st->latency.total;
+
+    _Bool ok = win_rate >= base->min_win_rate
+            && avg_survival >= base->min_avg_survival
+            && (base->max_p99_us == 0 || p99_us <= base->max_p99_us)
+            && (base->max_overrun_rate == 0 || overrun_rate <= base->max_overrun_rate);
+    passed = passed && ok;
+
+    chprintf(out, "%s,%d,%s,%u,%u,%u,%u,%u,%u,%u,%u,%s\r\n",
+             s->name, i, player_kind_names[s->players[i]],
+             s->games, st->wins, win_rate, avg_survival,
+             st->apples / s->games, mean_us, p99_us,
+             (unsigned int) ((uint64_t) total_ticks * 1000 / elapsed_ms),
+             ok ? "PASS" : "FAIL");
+
+    if (s->players[i] == PlayerKind_PATH)
+      chprintf(out, "# %s: player %d replans %u, repairs %u per game\r\n",
+               s->name, i, st->replans / s->games, st->repairs / s->games);
+
+    if (s->players[i] == PlayerKind_SEARCH && s->frame_budget_us > 0)
+      chprintf(out, "# %s: player %d slice %u us, mean depth %u.%02u, overruns %u (%u.%u%%)\r\n",
+               s->name, i, (unsigned int) AIBudget_getSliceMicroseconds(&budget),
+               st->decisions ? st->depth_sum / st->decisions : 0,
+               st->decisions ? st->depth_sum * 100 / st->decisions % 100 : 0,
+               st->overruns, overrun_rate / 10, overrun_rate % 10);
+    else if (s->frame_budget_us > 0)
+      chprintf(out, "# %s: player %d slice %u us, overruns %u (%u.%u%%)\r\n",
+               s->name, i, (unsigned int) AIBudget_getSliceMicroseconds(&budget),
+               st->overruns, overrun_rate / 10, overrun_rate % 10);
+  }
+
+  chprintf(out, "# %s: world model mean %u us, p99 %u us\r\n", s->name,
+           (unsigned int) (world_latency.total == 0 ? 0
+                           : cyclesToMicroseconds(world_latency.sum / world_latency.total)),
+           (unsigned int) cyclesToMicroseconds(LatencyHistogram_percentile(&world_latency, 99)));
+
+  chprintf(out, "# %s: hash %08x, transposition hit rate %u%%\r\n",
+           s->name, (unsigned int) hash, TranspositionTable_getHitRate(&transpositions));
+  return passed;
+}
+
+/* Symbol: Tournament_playSeriesAtResolution
+ *   Come [Tournament_playSeries], ma gioca la serie con la
+ *   sua risoluzione e poi ripristina quella di prima.
+ */
+static _Bool Tournament_playSeriesAtResolution(const TournamentSeries *s)
+{
+  unsigned int x_res, y_res;
+  Display_getResolution(&x_res, &y_res);
+  if (s->resolution)
+    Display_changeResolution(s->resolution, s->resolution);
+
+  _Bool passed = Tournament_playSeries(s);
+  Display_changeResolution(x_res, y_res);
+  return passed;
+}
+
+/* Symbol: Tournament_benchmarkRandom
+ *   Misura quanti cicli di clock costa in media un numero
+ *   generato col vecchio generatore congruenziale, con
+ *   [Rng_next] e con [Rng_bounded] (limitato al numero di
+ *   celle della griglia, come per la mela), e con le
+ *   versioni a blocchi [Rng_fillBounded] e
+ *   [RngLanes_fillBounded].
+ */
+#define RANDOM_BENCHMARK_VALUES 100000
+#define RANDOM_BENCHMARK_BLOCK  64
+
+static void Tournament_benchmarkRandom(void)
+{
+  volatile uint32_t sink = 0;
+  uint32_t acc = 0;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  int seed = 69420;
+  for (unsigned int i = 0; i < RANDOM_BENCHMARK_VALUES; ++i) {
+    seed = generateRandomPositiveIntegerUsingSeed(seed);
+    acc += seed;
+  }
+  uint32_t lcg = chSysGetRealtimeCounterX() - start;
+  sink = acc;
+
+  Rng rng;
+  Rng_init(&rng, 69420);
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < RANDOM_BENCHMARK_VALUES; ++i)
+    acc += Rng_next(&rng);
+  uint32_t next = chSysGetRealtimeCounterX() - start;
+  sink = acc;
+
+  const uint32_t cells = Display_getWidth() * Display_getHeight();
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < RANDOM_BENCHMARK_VALUES; ++i)
+    acc += Rng_bounded(&rng, cells);
+  uint32_t bounded = chSysGetRealtimeCounterX() - start;
+  sink = acc;
+
+  uint16_t block[RANDOM_BENCHMARK_BLOCK];
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < RANDOM_BENCHMARK_VALUES; i += RANDOM_BENCHMARK_BLOCK) {
+    Rng_fillBounded(&rng, cells, block, RANDOM_BENCHMARK_BLOCK);
+    acc += block[i % RANDOM_BENCHMARK_BLOCK];
+  }
+  uint32_t batched = chSysGetRealtimeCounterX() - start;
+  sink = acc;
+
+  RngLanes lanes;
+  RngLanes_init(&lanes, &rng);
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < RANDOM_BENCHMARK_VALUES; i += RANDOM_BENCHMARK_BLOCK) {
+    RngLanes_fillBounded(&lanes, cells, block, RANDOM_BENCHMARK_BLOCK);
+    acc += block[i % RANDOM_BENCHMARK_BLOCK];
+  }
+  uint32_t laned = chSysGetRealtimeCounterX() - start;
+  sink = acc;
+  (void) sink;
+
+  const uint32_t per = RANDOM_BENCHMARK_VALUES / 100;
+  chprintf(out, "# random cycles per 100 values: lcg %u, xoshiro128++ %u, bounded %u, "
+                "batched %u, lanes %u\r\n",
+           (unsigned int) (lcg / per), (unsigned int) (next / per),
+           (unsigned int) (bounded / per), (unsigned int) (batched / per),
+           (unsigned int) (laned / per));
+}
+
+/* Symbol: Tournament_benchmarkDisplay
+ *   Misura quanti cicli di clock costa disegnare nel
+ *   framebuffer una cella della griglia di gioco con
+ *   [Display_drawPixel], alla risoluzione corrente, e
+ *   l'immagine del menù con [Display_drawImage] e un
+ *   carattere di testo con [Display_drawText] (ad una riga
+ *   allineata alle pagine e ad una no), ed il costo di un
+ *   [Display_clear] dell'intero framebuffer.
+ *   I frame non vengono inviati al display.
+ */
+#define DISPLAY_BENCHMARK_CELLS  100000
+#define DISPLAY_BENCHMARK_IMAGES 10000
+#define DISPLAY_BENCHMARK_TEXTS  10000
+#define DISPLAY_BENCHMARK_STRING "MAIN MENU"
+#define DISPLAY_BENCHMARK_CLEARS 1000
+
+static void Tournament_benchmarkDisplay(void)
+{
+  const unsigned int w = Display_getWidth();
+  const unsigned int h = Display_getHeight();
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < DISPLAY_BENCHMARK_CELLS; ++i)
+    Display_drawPixel(i % w, i / w % h, i / (w * h) % 2);
+  uint32_t cells = (chSysGetRealtimeCounterX() - start) / (DISPLAY_BENCHMARK_CELLS / 100);
+
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < DISPLAY_BENCHMARK_IMAGES; ++i)
+    Display_drawImage(snake_image, SNAKE_RES_X, SNAKE_RES_Y, 28, i % 2 ? 30 : 32, 1);
+  uint32_t image = (chSysGetRealtimeCounterX() - start) / DISPLAY_BENCHMARK_IMAGES;
+
+  const unsigned int chars = sizeof(DISPLAY_BENCHMARK_STRING) - 1;
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < DISPLAY_BENCHMARK_TEXTS; ++i)
+    Display_drawText(DISPLAY_BENCHMARK_STRING, 37, i % 2 ? 13 : 16, 0);
+  uint32_t text = (chSysGetRealtimeCounterX() - start) / (DISPLAY_BENCHMARK_TEXTS * chars);
+
+  start = chSysGetRealtimeCounterX();
+  for (unsigned int i = 0; i < DISPLAY_BENCHMARK_CLEARS; ++i)
+    Display_clear(i % 2);
+  uint32_t clear = (chSysGetRealtimeCounterX() - start) / DISPLAY_BENCHMARK_CLEARS;
+
+  Display_clear(0);
+  chprintf(out, "# display cycles per 100 cells: %u (%u cells/s), per snake_image: %u, per char: %u (%u chars/s), per clear: %u\r\n",
+           (unsigned int) cells,
+           (unsigned int) ((uint64_t) STM32_HCLK * 100 / (cells ? cells : 1)),
+           (unsigned int) image, (unsigned int) text,
+           (unsigned int) (STM32_HCLK / (text ? text : 1)),
+           (unsigned int) clear);
+}
+
+/* Symbol: Tournament_checkDisplay
+ *   Disegna DISPLAY_CHECK_FRAMES frame casuali (pixel, testo e
+ *   schermate piene) e ogni 4 [Display_update] controlla che
+ *   la RAM del display coincida con quella che avrebbe
+ *   scritto un aggiornamento completo. Serve a verificare gli
+ *   aggiornamenti parziali del driver, e richiede che il
+ *   driver sia compilato con SSD1306_USE_PANEL_MODEL.
+ */
+#define DISPLAY_CHECK_FRAMES 500
+
+static _Bool Tournament_checkDisplay(void)
+{
+#if SSD1306_USE_PANEL_MODEL
+  Rng rng;
+  Rng_init(&rng, 0xD15B1A7);
+
+  const unsigned int w = Display_getWidth();
+  const unsigned int h = Display_getHeight();
+
+  unsigned int frame;
+  unsigned int start_bytes = Display_getBytesSent();
+  for (frame = 0; frame < DISPLAY_CHECK_FRAMES; ++frame) {
+
+    switch (Rng_bounded(&rng, 8)) {
+    case 0:
+      Display_clear(Rng_bounded(&rng, 2));
+      break;
+    case 1:
+      Display_drawText("SNAKE", Rng_bounded(&rng, 128), Rng_bounded(&rng, 64),
+                       Rng_bounded(&rng, 2));
+      break;
+    default:
+      for (unsigned int n = Rng_bounded(&rng, 16); n > 0; --n)
+        Display_drawPixel(Rng_bounded(&rng, w), Rng_bounded(&rng, h),
+                          Rng_bounded(&rng, 2));
+      break;
+    }
+
+    // Tra un controllo e l'altro i frame vengono disegnati
+    // mentre il precedente è ancora in trasmissione.
+    Display_update();
+    if (frame % 4 == 3 && !Display_isPanelSynced())
+      break;
+  }
+
+  _Bool passed = frame == DISPLAY_CHECK_FRAMES;
+  chprintf(out, "# display check: %u frames, %u bytes per frame, %s\r\n",
+           frame, (Display_getBytesSent() - start_bytes) / DISPLAY_CHECK_FRAMES,
+           passed ? "PASS" : "FAIL");
+  Display_clear(0);
+  Display_update();
+  return passed;
+#else
+  chprintf(out, "# display check skipped, SSD1306_USE_PANEL_MODEL is off\r\n");
+  return 1;
+#endif
+}
+
+#if AI_SEARCH_WORKERS > 1
+
+/* Symbol: Tournament_benchmarkSearch
+ *   Gioca le prime partite di search_vs_ai con 1, 2, 4 ed
+ *   8 thread di ricerca (vedi [SearchJoystick_setWorkers])
+ *   e stampa per ognuno il tempo medio di una decisione del
+ *   giocatore con ricerca, lo speedup rispetto ad un thread
+ *   e l'hash delle partite. Il tempo è quello reale, non
+ *   quello di CPU, quindi lo speedup dipende dai core liberi.
+ */
+#define SEARCH_BENCHMARK_GAMES 4
+#define SEARCH_BENCHMARK_TICKS 500
+
+static void Tournament_benchmarkSearch(void)
+{
+  static const unsigned int worker_counts[] = { 1, 2, 4, 8 };
+  static const PlayerKind players[] = { PlayerKind_SEARCH, PlayerKind_AI };
+  uint64_t single_cycles = 0;
+
+  for (unsigned int c = 0; c < sizeof(worker_counts) / sizeof(worker_counts[0]); ++c) {
+
+    unsigned int workers = SearchJoystick_setWorkers(worker_counts[c]);
+    memset(stats, 0, 2 * sizeof(stats[0]));
+    TranspositionTable_clear(&transpositions);
+    uint32_t hash = 0;
+
+    for (unsigned int g = 0; g < SEARCH_BENCHMARK_GAMES; ++g) {
+      setSeed(777 + g);
+      Game *game = Game_new(1);
+      if (game == 0) {
+        chprintf(out, "# search workers: couldn't create game\r\n");
+        SearchJoystick_setWorkers(1);
+        return;
+      }
+      Game_setHeadless(game, 1);
+      Game_setTickLimit(game, SEARCH_BENCHMARK_TICKS);
+      world_built_at = 0;
+
+      for (int i = 0; i < 2; ++i) {
+        TimedJoystick *timed = &timed_joysticks[i];
+        timed->base.table = &timed_table;
+        timed->inner = createJoystick(players[i], &joysticks[i], game, 0);
+        timed->game = game;
+        timed->stats = &stats[i];
+        timed->budget_bot = -1;
+        Game_plugJoystick(game, (Joystick*) timed);
+      }
+
+      Game_play(game);
+      hash ^= Game_getHash(game);
+      for (int i = 0; i < 2; ++i)
+        Joystick_free(timed_joysticks[i].inner);
+      Game_free(game);
+    }
+
+    const LatencyHistogram *hist = &stats[0].latency;
+    uint64_t mean_cycles = hist->total == 0 ? 1 : hist->sum / hist->total;
+    if (mean_cycles == 0)
+      mean_cycles = 1;
+    if (c == 0)
+      single_cycles = mean_cycles;
+    unsigned int speedup = single_cycles * 100 / mean_cycles;
+
+    chprintf(out, "# search workers %u: %u us per decision, speedup %u.%02u, hash %08x\r\n",
+             workers, (unsigned int) cyclesToMicroseconds(mean_cycles),
+             speedup / 100, speedup % 100, (unsigned int) hash);
+  }
+  SearchJoystick_setWorkers(1);
+}
+
+#endif /* AI_SEARCH_WORKERS > 1 */
+
+static void Tournament_start(void)
+{
+  // La seriale è la stessa del logger, che però
+  // non viene avviato se NOLOGGING è definito.
+  if (SD2.state != SD_READY) {
+    palSetPadMode(GPIOA, 2, PAL_MODE_ALTERNATE(7));
+    palSetPadMode(GPIOA, 3, PAL_MODE_ALTERNATE(7));
+    sdStart(&SD2, NULL);
+  }
+}
+
+static void Tournament_printHeader(void)
+{
+  chprintf(out, "series,player,kind,games,wins,win_rate,avg_survival_ticks,"
+                "avg_apples,mean_decision_us,p99_decision_us,ticks_per_sec,result\r\n");
+}
+
+/* Symbol: Tournament_runChecks
+ *   Stampa i byte inviati all'avvio del display ed i costi
+ *   misurati da [Tournament_benchmarkRandom],
+ *   [Tournament_benchmarkDisplay] e, sull'host con più
+ *   thread di ricerca, [Tournament_benchmarkSearch], poi
+ *   esegue [Tournament_checkDisplay]. Ritorna 0 se il
+ *   controllo del display fallisce.
+ */
+_Bool Tournament_runChecks(void)
+{
+  Tournament_start();
+
+  // Il display è stato appena avviato da Display_init.
+  chprintf(out, "# display startup: %u bytes in %u transfers\r\n",
+           Display_getBytesSent(), Display_getTransfers());
+
+  Tournament_benchmarkRandom();
+  Tournament_benchmarkDisplay();
+#if AI_SEARCH_WORKERS > 1
+  Tournament_benchmarkSearch();
+#endif
+  return Tournament_checkDisplay();
+}
+
+/* Symbol: Tournament_getSeriesName
+ *   Ritorna il nome della serie [index], oppure 0 se le
+ *   serie sono meno di index + 1.
+ */
+const char *Tournament_getSeriesName(unsigned int index)
+{
+  if (index >= sizeof(series) / sizeof(series[0]))
+    return 0;
+  return series[index].name;
+}
+
+/* Symbol: Tournament_runSeries
+ *   Gioca la serie chiamata [name], stampando l'intestazione
+ *   CSV prima dei risultati. Ritorna 1 se tutti i giocatori
+ *   hanno rispettato la loro baseline, 0 altrimenti o se
+ *   la serie non esiste.
+ */
+_Bool Tournament_runSeries(const char *name)
+{
+  Tournament_start();
+
+  for (unsigned int i = 0; i < sizeof(series) / sizeof(series[0]); ++i) {
+    if (strcmp(series[i].name, name) == 0) {
+      Tournament_printHeader();
+      return Tournament_playSeriesAtResolution(&series[i]);
+    }
+  }
+  chprintf(out, "# unknown series %s\r\n", name);
+  return 0;
+}
+
+/* Symbol: Tournament_run
+ *   Esegue i controlli (vedi [Tournament_runChecks]) e gioca
+ *   tutte le serie del torneo. Ritorna 1 se tutti i
+ *   giocatori hanno rispettato la loro baseline, 0 se almeno
+ *   uno è risultato più lento o più debole o se un controllo
+ *   è fallito.
+ */
+_Bool Tournament_run(void)
+{
+  _Bool passed = Tournament_runChecks();
+
+  Tournament_printHeader();
+  for (unsigned int i = 0; i < sizeof(series) / sizeof(series[0]); ++i)
+    passed = Tournament_playSeriesAtResolution(&series[i]) && passed;
+
+  chprintf(out, "# tournament %s\r\n", passed ? "PASSED" : "FAILED");
+  return passed;
+}
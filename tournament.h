@@ -0,0 +1,9 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+_Bool       Tournament_run(void);
+_Bool       Tournament_runChecks(void);
+_Bool       Tournament_runSeries(const char *name);
+const char *Tournament_getSeriesName(unsigned int index);
+
+#endif /* TOURNAMENT_H */
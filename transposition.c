@@ -0,0 +1,87 @@
+#include <string.h>
+#include "transposition.h"
+
+/* Symbol: TranspositionTable_clear
+ *   Svuota la tabella ed azzera i contatori.
+ */
+void TranspositionTable_clear(TranspositionTable *table)
+{
+  memset(table->entries, 0, sizeof(table->entries));
+  table->generation = 1; // Gli elementi vuoti hanno generazione 0.
+  table->probes = 0;
+  table->hits = 0;
+}
+
+/* Symbol: TranspositionTable_newSearch
+ *   Segnala l'inizio di una nuova ricerca. Gli elementi
+ *   memorizzati dalle ricerche precedenti restano validi,
+ *   ma vengono sostituiti per primi (vedi
+ *   [TranspositionTable_store]).
+ */
+void TranspositionTable_newSearch(TranspositionTable *table)
+{
+  table->generation++;
+  if (table->generation == 0)
+    table->generation = 1;
+}
+
+static TranspositionEntry *getEntry(TranspositionTable *table, uint32_t key)
+{
+  return &table->entries[key & (TT_ENTRIES - 1)];
+}
+
+/* Symbol: TranspositionTable_probe
+ *   Cerca la posizione con hash [key]. Se è presente ed
+ *   è stata esplorata per almeno [depth] mosse, ne scrive
+ *   il valore in [value] e ritorna 1. Altrimenti ritorna 0.
+ */
+_Bool TranspositionTable_probe(TranspositionTable *table, uint32_t key,
+                               unsigned int depth, int *value)
+{
+  table->probes++;
+
+  TranspositionEntry *entry = getEntry(table, key);
+  if (entry->generation == 0 || entry->key != key || entry->depth < depth)
+    return 0;
+
+  table->hits++;
+  *value = entry->value;
+  return 1;
+}
+
+/* Symbol: TranspositionTable_store
+ *   Memorizza il valore [value] della posizione [key]
+ *   esplorata per [depth] mosse.
+ *
+ *   Ogni posizione può andare in un solo elemento. Se è
+ *   già occupato da un'altra posizione, questa viene
+ *   sostituita solo se è di una ricerca precedente oppure
+ *   se è stata esplorata per meno mosse, perché le
+ *   posizioni esplorate più a fondo sono quelle che fanno
+ *   risparmiare più lavoro.
+ */
+void TranspositionTable_store(TranspositionTable *table, uint32_t key,
+                              unsigned int depth, int value)
+{
+  TranspositionEntry *entry = getEntry(table, key);
+
+  if (entry->generation == table->generation &&
+      entry->key != key && entry->depth > depth)
+    return;
+
+  entry->key = key;
+  entry->value = value;
+  entry->depth = depth;
+  entry->generation = table->generation;
+}
+
+/* Symbol: TranspositionTable_getHitRate
+ *   Ritorna la percentuale di ricerche nella tabella che
+ *   hanno trovato un risultato utilizzabile.
+ */
+unsigned int TranspositionTable_getHitRate(TranspositionTable *table)
+{
+  if (table->probes == 0)
+    return 0;
+  return (unsigned int) ((uint64_t) table->hits * 100 / table->probes);
+}
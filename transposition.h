@@ -0,0 +1,48 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdint.h>
+#include "config.h"
+
+/* Symbol: TranspositionEntry
+ *   Risultato di una ricerca memorizzato nella tabella.
+ *   [key] è l'hash completo della posizione, usato per
+ *   distinguere le posizioni che finiscono nello stesso
+ *   elemento. [depth] è il numero di mosse esplorate a
+ *   partire dalla posizione per ottenere [value].
+ */
+typedef struct {
+  uint32_t key;
+  int16_t  value;
+  uint8_t  depth;
+  uint8_t  generation;
+} TranspositionEntry;
+
+/* Symbol: TranspositionTable
+ *   Tabella delle trasposizioni di dimensione fissa
+ *   (TT_ENTRIES elementi), indicizzata con i bit bassi
+ *   dell'hash di Zobrist della posizione (vedi [zobristKey]).
+ *   Permette ad una ricerca di non valutare più volte una
+ *   posizione raggiunta con ordini di mosse diversi.
+ *
+ *   [probes] e [hits] contano le ricerche nella tabella e
+ *   quelle che hanno trovato un risultato utilizzabile
+ *   (vedi [TranspositionTable_getHitRate]).
+ */
+typedef struct TranspositionTable TranspositionTable;
+struct TranspositionTable {
+  TranspositionEntry entries[TT_ENTRIES];
+  uint8_t  generation;
+  uint32_t probes;
+  uint32_t hits;
+};
+
+void  TranspositionTable_clear(TranspositionTable *table);
+void  TranspositionTable_newSearch(TranspositionTable *table);
+_Bool TranspositionTable_probe(TranspositionTable *table, uint32_t key,
+                               unsigned int depth, int *value);
+void  TranspositionTable_store(TranspositionTable *table, uint32_t key,
+                               unsigned int depth, int value);
+unsigned int TranspositionTable_getHitRate(TranspositionTable *table);
+
+#endif /* TRANSPOSITION_H */
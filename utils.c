@@ -3,35 +3,316 @@
 #include "logger.h"
 #include "display.h"
 
-static int seed_ = 69420;
+/* Symbol: Rng
+ *   Generatore xoshiro128++ di Blackman e Vigna: 128 bit
+ *   di stato, periodo 2^128 - 1, e solo somme, XOR e
+ *   rotazioni, quindi costa pochi cicli anche su un
+ *   Cortex-M4.
+ *
+ *   Ogni partita e ogni joystick casuale ha il proprio
+ *   stato, cos che le sequenze non dipendano da quanti
+ *   numeri generano gli altri. Gli stati sono ottenuti
+ *   dal generatore di default con [Rng_split], oppure da
+ *   un seme con [Rng_init].
+ */
+
+static Rng default_rng;
+static _Bool default_rng_ready = 0;
+
+static uint32_t rotl(uint32_t x, int k)
+{
+  return (x << k) | (x >> (32 - k));
+}
+
+/* Symbol: Rng_init
+ *   Inizializza lo stato a partire da [seed]. Le quattro
+ *   parole sono generate con SplitMix32, cos che semi
+ *   vicini diano stati molto diversi e lo stato non sia
+ *   mai tutto a zero.
+ */
+void Rng_init(Rng *rng, uint32_t seed)
+{
+  for (int i = 0; i < 4; ++i) {
+    uint32_t z = (seed += 0x9E3779B9);
+    z = (z ^ (z >> 16)) * 0x85EBCA6B;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35;
+    rng->s[i] = z ^ (z >> 16);
+  }
+}
+
+uint32_t Rng_next(Rng *rng)
+{
+  uint32_t *s = rng->s;
+  uint32_t result = rotl(s[0] + s[3], 7) + s[0];
+  uint32_t t = s[1] << 9;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 11);
+
+  return result;
+}
+
+/* Symbol: Rng_bounded
+ *   Ritorna un intero uniforme in [0, bound), con bound > 0.
+ *
+ *   Usa il metodo di Lemire: la parte alta del prodotto a 64
+ *   bit tra il numero generato e [bound]  gi nell'intervallo
+ *   giusto, e i pochi valori che darebbero una distribuzione
+ *   non uniforme vengono scartati. Al contrario del modulo non
+ *   favorisce i valori piccoli, e la divisione serve solo nel
+ *   caso raro in cui il valore va forse scartato.
+ */
+uint32_t Rng_bounded(Rng *rng, uint32_t bound)
+{
+  uint64_t m = (uint64_t) Rng_next(rng) * bound;
+  uint32_t low = (uint32_t) m;
+  if (low < bound) {
+    uint32_t threshold = -bound % bound;
+    while (low < threshold) {
+      m = (uint64_t) Rng_next(rng) * bound;
+      low = (uint32_t) m;
+    }
+  }
+  return m >> 32;
+}
+
+/* Symbol: Rng_jump
+ *   Porta lo stato avanti di 2^64 numeri, in un tempo pari
+ *   a circa 128 chiamate di [Rng_next]. Partendo dallo
+ *   stesso stato e saltando k volte si ottengono sequenze
+ *   che non si sovrappongono, una per ogni simulazione.
+ */
+void Rng_jump(Rng *rng)
+{
+  static const uint32_t jump[] = { 0x8764000B, 0xF542D2D3, 0x6FA035C3, 0x77F2DB5B };
+
+  uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (int i = 0; i < 4; ++i)
+    for (int b = 0; b < 32; ++b) {
+      if (jump[i] & (UINT32_C(1) << b)) {
+        s0 ^= rng->s[0];
+        s1 ^= rng->s[1];
+        s2 ^= rng->s[2];
+        s3 ^= rng->s[3];
+      }
+      Rng_next(rng);
+    }
+
+  rng->s[0] = s0;
+  rng->s[1] = s1;
+  rng->s[2] = s2;
+  rng->s[3] = s3;
+}
+
+/* Symbol: Rng_split
+ *   Copia lo stato di [rng] in [stream] e fa saltare [rng]
+ *   in avanti (vedi [Rng_jump]). [stream] genera i prossimi
+ *   2^64 numeri di [rng], che da l in poi non li generer.
+ */
+void Rng_split(Rng *rng, Rng *stream)
+{
+  *stream = *rng;
+  Rng_jump(rng);
+}
+
+/* Symbol: Rng_position
+ *   Genera una posizione uniforme sullo schermo.
+ */
+Position Rng_position(Rng *rng)
+{
+  return (Position) {
+    .x = Rng_bounded(rng, Display_getWidth()),
+    .y = Rng_bounded(rng, Display_getHeight()),
+  };
+}
+
+/* Symbol: Rng_fill
+ *   Scrive in [out] i prossimi [count] numeri di [rng]. Il
+ *   ciclo  srotolato di 4, e lo stato resta nei registri
+ *   per tutta la chiamata invece di essere riletto ad ogni
+ *   numero come con [Rng_next].
+ */
+void Rng_fill(Rng *rng, uint32_t *out, unsigned int count)
+{
+  uint32_t s0 = rng->s[0], s1 = rng->s[1], s2 = rng->s[2], s3 = rng->s[3];
+
+#define RNG_STEP(dst)                       \
+  do {                                      \
+    (dst) = rotl(s0 + s3, 7) + s0;          \
+    uint32_t t = s1 << 9;                   \
+    s2 ^= s0; s3 ^= s1; s1 ^= s2; s0 ^= s3; \
+    s2 ^= t;  s3 = rotl(s3, 11);            \
+  } while (0)
+
+  unsigned int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    RNG_STEP(out[i]);
+    RNG_STEP(out[i + 1]);
+    RNG_STEP(out[i + 2]);
+    RNG_STEP(out[i + 3]);
+  }
+  for (; i < count; ++i)
+    RNG_STEP(out[i]);
+
+#undef RNG_STEP
+
+  rng->s[0] = s0; rng->s[1] = s1; rng->s[2] = s2; rng->s[3] = s3;
+}
+
+/* Symbol: boundValues
+ *   Trasforma in posto i numeri [values] in interi uniformi
+ *   in [0, bound) come [Rng_bounded]. La soglia di scarto
+ *   (l'unica divisione)  calcolata una volta sola per tutto
+ *   il blocco; i rari valori da scartare sono sostituiti con
+ *   [Rng_bounded] su [rng].
+ */
+static void boundValues(Rng *rng, uint32_t bound, const uint32_t *values,
+                        uint16_t *out, unsigned int count)
+{
+  const uint32_t threshold = -bound % bound;
+  for (unsigned int i = 0; i < count; ++i) {
+    uint64_t m = (uint64_t) values[i] * bound;
+    out[i] = ((uint32_t) m < threshold) ? Rng_bounded(rng, bound) : (m >> 32);
+  }
+}
+
+// Numeri generati alla volta dalle funzioni *_fillBounded.
+#define RNG_BLOCK 32
+
+/* Symbol: Rng_fillBounded
+ *   Scrive in [out] [count] interi uniformi in [0, bound),
+ *   con 0 < bound <= 65536. Equivale a chiamare [count]
+ *   volte [Rng_bounded], ma costa meno perch i numeri sono
+ *   generati a blocchi con [Rng_fill].
+ */
+void Rng_fillBounded(Rng *rng, uint32_t bound, uint16_t *out, unsigned int count)
+{
+  uint32_t block[RNG_BLOCK];
+  while (count > 0) {
+    unsigned int n = (count < RNG_BLOCK) ? count : RNG_BLOCK;
+    Rng_fill(rng, block, n);
+    boundValues(rng, bound, block, out, n);
+    out += n;
+    count -= n;
+  }
+}
+
+/* Symbol: RngLanes_init
+ *   Inizializza ogni corsia con uno stream diverso di [rng]
+ *   (vedi [Rng_split]).
+ */
+void RngLanes_init(RngLanes *lanes, Rng *rng)
+{
+  for (int lane = 0; lane < RNG_LANES; ++lane) {
+    Rng stream;
+    Rng_split(rng, &stream);
+    for (int k = 0; k < 4; ++k)
+      lanes->s[k][lane] = stream.s[k];
+  }
+}
+
+/* Symbol: RngLanes_fill
+ *   Scrive in [out] [count] numeri, prendendoli a turno dalle
+ *   corsie. Ogni iterazione fa un passo di xoshiro128++ su
+ *   tutte le corsie insieme: sull'host il ciclo interno
+ *   diventa una manciata di istruzioni SIMD, sulla scheda
+ *   le corsie indipendenti riempiono la pipeline.
+ */
+void RngLanes_fill(RngLanes *lanes, uint32_t *out, unsigned int count)
+{
+  uint32_t (*s)[RNG_LANES] = lanes->s;
+
+  unsigned int i = 0;
+  for (; i + RNG_LANES <= count; i += RNG_LANES)
+    for (int lane = 0; lane < RNG_LANES; ++lane) {
+      out[i + lane] = rotl(s[0][lane] + s[3][lane], 7) + s[0][lane];
+      uint32_t t = s[1][lane] << 9;
+      s[2][lane] ^= s[0][lane];
+      s[3][lane] ^= s[1][lane];
+      s[1][lane] ^= s[2][lane];
+      s[0][lane] ^= s[3][lane];
+      s[2][lane] ^= t;
+      s[3][lane] = rotl(s[3][lane], 11);
+    }
+
+  // Gli ultimi numeri vengono dalla prima corsia.
+  if (i < count) {
+    Rng first = { .s = { s[0][0], s[1][0], s[2][0], s[3][0] } };
+    Rng_fill(&first, out + i, count - i);
+    for (int k = 0; k < 4; ++k)
+      s[k][0] = first.s[k];
+  }
+}
+
+/* Symbol: RngLanes_fillBounded
+ *   Come [Rng_fillBounded], ma i numeri sono generati con
+ *   [RngLanes_fill]. I valori scartati sono rigenerati
+ *   dalla prima corsia.
+ */
+void RngLanes_fillBounded(RngLanes *lanes, uint32_t bound, uint16_t *out, unsigned int count)
+{
+  uint32_t block[RNG_BLOCK];
+  while (count > 0) {
+    unsigned int n = (count < RNG_BLOCK) ? count : RNG_BLOCK;
+    RngLanes_fill(lanes, block, n);
+
+    Rng first = { .s = { lanes->s[0][0], lanes->s[1][0], lanes->s[2][0], lanes->s[3][0] } };
+    boundValues(&first, bound, block, out, n);
+    for (int k = 0; k < 4; ++k)
+      lanes->s[k][0] = first.s[k];
+
+    out += n;
+    count -= n;
+  }
+}
 
 void setSeed(int seed)
 {
-  seed_ = seed;
+  Rng_init(&default_rng, seed);
+  default_rng_ready = 1;
+}
+
+/* Symbol: getDefaultRng
+ *   Ritorna il generatore condiviso, inizializzato con
+ *   [setSeed] (o con un seme fisso se non  mai stato
+ *   chiamato). Va usato solo per creare gli stati delle
+ *   partite e dei joystick.
+ */
+Rng *getDefaultRng(void)
+{
+  if (!default_rng_ready)
+    setSeed(69420);
+  return &default_rng;
 }
 
-int generateRandomInteger(void) {
-  seed_ = generateRandomIntegerUsingSeed(seed_);
-  return seed_;
+int generateRandomInteger(void)
+{
+  return Rng_next(getDefaultRng()) >> 1;
 }
 
+/* Symbol: generateRandomIntegerUsingSeed
+ *   Vecchio generatore congruenziale lineare, non pi usato
+ *   dal gioco ma mantenuto come riferimento per il
+ *   benchmark del torneo (vedi [Tournament_run]). Il calcolo
+ *    fatto senza segno perch il prodotto con segno va in
+ *   overflow.
+ */
 int generateRandomIntegerUsingSeed(int seed)
 {
-  //if (seed == 0)
-  //  seed = 1; // Se il seme  zero, generer un altro zero.
-  //int temp = seed * 15485863; // + chVTGetSystemTime();
-  //seed = temp * temp * temp % 2038074743;
-
-  seed = (seed * 1103515245 + 12345) % (1 << 31);
-  return seed;
+  return (int) ((uint32_t) seed * 1103515245u + 12345u);
 }
 
+/* Symbol: generateRandomPositiveIntegerUsingSeed
+ *   Come [generateRandomIntegerUsingSeed], ma tiene solo i
+ *   31 bit bassi: cambiare segno a INT_MIN non si pu.
+ */
 int generateRandomPositiveIntegerUsingSeed(int seed)
 {
-  int n = generateRandomIntegerUsingSeed(seed);
-  if (n < 0)
-    return -n;
-  return n;
+  return generateRandomIntegerUsingSeed(seed) & 0x7FFFFFFF;
 }
 
 /* Symbol: newPosition
@@ -62,8 +343,7 @@ Position newPosition(int x, int y)
  */
 Position newRandomPosition(void)
 {
-  return newPosition(generateRandomInteger(),
-                     generateRandomInteger());
+  return Rng_position(getDefaultRng());
 }
 
 /* Symbol: evaluateNextPosition
@@ -114,6 +394,33 @@ Direction oppositeDirection(Direction dir)
   return DIR_LEFT; // For the warning.
 }
 
+/* Symbol: zobristKey
+ *   Ritorna la chiave di Zobrist di un elemento [piece]
+ *   appartenente al giocatore [owner] nella cella [pos].
+ *   L'hash di uno stato  lo XOR delle chiavi dei suoi
+ *   elementi, quindi aggiungere o togliere un elemento
+ *   costa uno XOR.
+ *
+ * Nota: Invece di una tabella di chiavi casuali (che per
+ *       ogni tipo, giocatore e cella occuperebbe decine di
+ *       KB) la chiave  calcolata mescolando i bit degli
+ *       argomenti con il finalizzatore di MurmurHash3. Le
+ *       chiavi sono quindi le stesse su ogni scheda, come
+ *       serve per confrontare gli hash di due partite.
+ */
+uint32_t zobristKey(ZobristPiece piece, unsigned int owner, Position pos)
+{
+  uint32_t h = ((uint32_t) piece << 24) ^ ((owner & 0xFF) << 16)
+             ^ ((uint32_t) pos.y << 8) ^ pos.x;
+  h ^= 0x9E3779B9;
+  h ^= h >> 16;
+  h *= 0x85EBCA6B;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35;
+  h ^= h >> 16;
+  return h;
+}
+
 void delay(unsigned int ms)
 {
   chThdSleepMilliseconds(ms);
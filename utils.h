@@ -1,6 +1,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+
 typedef enum {
   DIR_LEFT, DIR_RIGHT,
   DIR_UP,   DIR_DOWN,
@@ -10,6 +12,39 @@ typedef struct {
   unsigned char x, y;
 } Position;
 
+/* Symbol: Rng
+ *   Stato di un generatore di numeri pseudo-casuali
+ *   xoshiro128++ (vedi [Rng_next]).
+ */
+typedef struct {
+  uint32_t s[4];
+} Rng;
+
+void     Rng_init(Rng *rng, uint32_t seed);
+uint32_t Rng_next(Rng *rng);
+uint32_t Rng_bounded(Rng *rng, uint32_t bound);
+void     Rng_jump(Rng *rng);
+void     Rng_split(Rng *rng, Rng *stream);
+Position Rng_position(Rng *rng);
+void     Rng_fill(Rng *rng, uint32_t *out, unsigned int count);
+void     Rng_fillBounded(Rng *rng, uint32_t bound, uint16_t *out, unsigned int count);
+
+/* Symbol: RngLanes
+ *   RNG_LANES generatori xoshiro128++ indipendenti, con lo
+ *   stato memorizzato per parola (s[k][lane]) così che i
+ *   cicli su tutte le corsie possano essere vettorizzati
+ *   dal compilatore (vedi [RngLanes_fill]).
+ */
+#define RNG_LANES 4
+
+typedef struct {
+  uint32_t s[4][RNG_LANES];
+} RngLanes;
+
+void RngLanes_init(RngLanes *lanes, Rng *rng);
+void RngLanes_fill(RngLanes *lanes, uint32_t *out, unsigned int count);
+void RngLanes_fillBounded(RngLanes *lanes, uint32_t bound, uint16_t *out, unsigned int count);
+
 Position  newPosition(int x, int y);
 Position  newRandomPosition(void);
 
@@ -17,10 +52,26 @@ Direction oppositeDirection(Direction dir);
 Position  evaluateNextPosition(Position pos, Direction dir);
 
 void setSeed(int seed);
+Rng *getDefaultRng(void);
 int  generateRandomInteger(void);
 int  generateRandomIntegerUsingSeed(int seed);
 int  generateRandomPositiveIntegerUsingSeed(int seed);
 
+/* Symbol: ZobristPiece
+ *   Tipi di elementi che compongono l'hash di Zobrist
+ *   dello stato di una partita (vedi [zobristKey]).
+ */
+typedef enum {
+  ZobristPiece_BODY,      // Cella occupata da un serpente
+  ZobristPiece_HEAD,      // Cella della testa di un serpente
+  ZobristPiece_DIRECTION, // Direzione di un serpente
+  ZobristPiece_APPLE,     // Cella della mela
+  ZobristPiece_GROW,      // Serpente che crescerà al prossimo passo
+  ZobristPiece_STEP,      // Mosse fatte durante una ricerca
+} ZobristPiece;
+
+uint32_t zobristKey(ZobristPiece piece, unsigned int owner, Position pos);
+
 void delay(unsigned int ms);
 
 #endif /* UTILS_H */
@@ -0,0 +1,374 @@
+#include <string.h>
+#include "world.h"
+#include "snake.h"
+#include "logger.h"
+#include "display.h"
+
+#define MASK_SET(mask, idx)  ((mask)[(idx) >> 5] |= (uint32_t) 1 << ((idx) & 31))
+#define MASK_TEST(mask, idx) (((mask)[(idx) >> 5] >> ((idx) & 31)) & 1)
+
+void WorldModel_invalidate(WorldModel *world)
+{
+  world->valid = 0;
+}
+
+int WorldModel_cellIndex(const WorldModel *world, Position pos)
+{
+  return pos.y * world->width + pos.x;
+}
+
+_Bool WorldModel_isOccupied(const WorldModel *world, Position pos)
+{
+  return MASK_TEST(world->occupied, WorldModel_cellIndex(world, pos));
+}
+
+_Bool WorldModel_isBlocked(const WorldModel *world, Position pos)
+{
+  return MASK_TEST(world->blocked, WorldModel_cellIndex(world, pos));
+}
+
+/* Symbol: WorldModel_isOpponentHeadAt
+ *   Ritorna 1 se la testa di un giocatore diverso da
+ *   [player] dovrebbe trovarsi in [pos] dopo il prossimo
+ *   update, 0 altrimenti.
+ */
+_Bool WorldModel_isOpponentHeadAt(const WorldModel *world, int player, Position pos)
+{
+  int idx = WorldModel_cellIndex(world, pos);
+
+  if (!MASK_TEST(world->predicted_heads, idx))
+    return 0;
+
+  for (int i = 0; i < world->player_count; ++i)
+    if (i != player && world->predicted_head[i] == idx)
+      return 1;
+  return 0;
+}
+
+unsigned int WorldModel_getAppleDistance(const WorldModel *world, Position pos)
+{
+  return world->apple_distance[WorldModel_cellIndex(world, pos)];
+}
+
+unsigned int WorldModel_getSafeDirections(const WorldModel *world, int player)
+{
+  return world->safe_directions[player];
+}
+
+/* Symbol: WorldModel_getCautiousDirections
+ *   Come [WorldModel_getSafeDirections], ma esclude anche
+ *   le direzioni che portano in una cella in cui un
+ *   avversario che si muove prima potrebbe entrare cambiando
+ *   direzione. Può essere vuota anche quando ci sono
+ *   direzioni sicure.
+ */
+unsigned int WorldModel_getCautiousDirections(const WorldModel *world, int player)
+{
+  return world->cautious_directions[player];
+}
+
+unsigned int WorldModel_getFreeIn(const WorldModel *world, Position pos)
+{
+  return world->free_in[WorldModel_cellIndex(world, pos)];
+}
+
+unsigned int WorldModel_getFreeCells(const WorldModel *world)
+{
+  return world->free_cells;
+}
+
+/* Symbol: WorldModel_getAlivePlayers
+ *   Ritorna il numero di giocatori ancora in gioco.
+ */
+unsigned int WorldModel_getAlivePlayers(const WorldModel *world)
+{
+  unsigned int alive = 0;
+  for (int i = 0; i < world->player_count; ++i)
+    alive += world->predicted_head[i] >= 0;
+  return alive;
+}
+
+/* Symbol: WorldModel_getNeighbour
+ *   Come [evaluateNextPosition], ma usa le dimensioni
+ *   del modello ed evita le divisioni.
+ */
+Position WorldModel_getNeighbour(const WorldModel *world, Position pos, Direction dir)
+{
+  int x = pos.x;
+  int y = pos.y;
+  switch (dir) {
+  case DIR_LEFT:  x = (x == 0) ? world->width-1 : x-1; break;
+  case DIR_RIGHT: x = (x == world->width-1) ? 0 : x+1; break;
+  case DIR_UP:    y = (y == 0) ? world->height-1 : y-1; break;
+  case DIR_DOWN:  y = (y == world->height-1) ? 0 : y+1; break;
+  }
+  return (Position) { .x = x, .y = y };
+}
+
+unsigned int WorldModel_getTerritory(const WorldModel *world, int player)
+{
+  return world->territory[player];
+}
+
+/* Symbol: WorldModel_getMoveTerritory
+ *   Ritorna il numero di celle che il giocatore [player]
+ *   raggiunge per primo iniziando con la mossa [dir], oppure
+ *   0 se [dir] non è tra le sue direzioni sicure.
+ */
+unsigned int WorldModel_getMoveTerritory(const WorldModel *world, int player, Direction dir)
+{
+  return world->move_territory[player][dir];
+}
+
+/* Symbol: WorldModel_computeAppleDistance
+ *   Riempie [apple_distance] con una BFS che parte dalla
+ *   mela e attraversa solo le celle non bloccate.
+ */
+static void WorldModel_computeAppleDistance(WorldModel *world, Position apple)
+{
+  const int cells = world->width * world->height;
+
+  for (int i = 0; i < cells; ++i)
+    world->apple_distance[i] = WORLD_UNREACHABLE;
+
+  int head = 0;
+  int tail = 0;
+  world->apple_distance[WorldModel_cellIndex(world, apple)] = 0;
+  world->bfs_queue[tail++] = apple;
+
+  while (head < tail) {
+    Position pos = world->bfs_queue[head++];
+    uint16_t dist = world->apple_distance[WorldModel_cellIndex(world, pos)];
+
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+      Position next = WorldModel_getNeighbour(world, pos, dir);
+      int idx = WorldModel_cellIndex(world, next);
+      if (world->apple_distance[idx] == WORLD_UNREACHABLE &&
+          !MASK_TEST(world->blocked, idx)) {
+        world->apple_distance[idx] = dist + 1;
+        world->bfs_queue[tail++] = next;
+      }
+    }
+  }
+}
+
+/* Symbol: WorldModel_computeTerritory
+ *   Riempie i campi [territory_*] con una sola BFS che parte
+ *   contemporaneamente da tutte le teste. Le sorgenti sono
+ *   le celle raggiungibili con le direzioni sicure di ogni
+ *   giocatore (a distanza 1), ognuna etichettata con la
+ *   propria mossa, quindi la stessa visita dice sia quante
+ *   celle ha ogni giocatore sia quante ne guadagna con ogni
+ *   mossa.
+ *
+ *   Una cella è attraversabile a distanza d se free_in <= d,
+ *   cioè se le code si sono già spostate quando ci arriva la
+ *   testa. Le celle raggiunte alla stessa distanza da più
+ *   giocatori sono contese: non appartengono a nessuno e la
+ *   visita non prosegue da esse. Le celle raggiunte alla
+ *   stessa distanza con più mosse dello stesso giocatore
+ *   valgono per tutte quelle mosse.
+ */
+static void WorldModel_computeTerritory(WorldModel *world, Snake **snakes,
+                                       const _Bool *lost)
+{
+  const int cells = world->width * world->height;
+
+  memset(world->territory_owner, WORLD_NO_OWNER, cells);
+  memset(world->territory, 0, sizeof(world->territory));
+  memset(world->move_territory, 0, sizeof(world->move_territory));
+
+  int head = 0;
+  int tail = 0;
+
+  for (int i = 0; i < world->player_count; ++i) {
+    if (lost[i])
+      continue;
+
+    Position pos = Snake_getHeadPosition(snakes[i]);
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+      if (!((world->safe_directions[i] >> dir) & 1))
+        continue;
+
+      Position next = WorldModel_getNeighbour(world, pos, dir);
+      int idx = WorldModel_cellIndex(world, next);
+      if (world->territory_owner[idx] == WORLD_NO_OWNER) {
+        world->territory_owner[idx] = i;
+        world->territory_moves[idx] = 1 << dir;
+        world->territory_distance[idx] = 1;
+        world->bfs_queue[tail++] = next;
+      } else if (world->territory_owner[idx] == i)
+        world->territory_moves[idx] |= 1 << dir;
+      else
+        world->territory_owner[idx] = WORLD_CONTESTED;
+    }
+  }
+
+  while (head < tail) {
+    Position pos = world->bfs_queue[head++];
+    int idx = WorldModel_cellIndex(world, pos);
+
+    uint8_t owner = world->territory_owner[idx];
+    if (owner == WORLD_CONTESTED)
+      continue;
+
+    uint8_t  moves = world->territory_moves[idx];
+    uint16_t dist  = world->territory_distance[idx] + 1;
+
+    world->territory[owner]++;
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir)
+      if ((moves >> dir) & 1)
+        world->move_territory[owner][dir]++;
+
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+      Position next = WorldModel_getNeighbour(world, pos, dir);
+      int next_idx = WorldModel_cellIndex(world, next);
+
+      if (world->free_in[next_idx] > dist)
+        continue;
+
+      uint8_t next_owner = world->territory_owner[next_idx];
+      if (next_owner == WORLD_NO_OWNER) {
+        world->territory_owner[next_idx] = owner;
+        world->territory_moves[next_idx] = moves;
+        world->territory_distance[next_idx] = dist;
+        world->bfs_queue[tail++] = next;
+      } else if (world->territory_distance[next_idx] == dist) {
+        // La cella è ancora in coda, quindi le mosse
+        // aggiunte qui si propagano quando viene visitata.
+        if (next_owner == owner)
+          world->territory_moves[next_idx] |= moves;
+        else
+          world->territory_owner[next_idx] = WORLD_CONTESTED;
+      }
+    }
+  }
+}
+
+/* Symbol: WorldModel_build
+ *   Ricostruisce il modello a partire dai serpenti dei
+ *   giocatori e dalla posizione della mela. I serpenti dei
+ *   giocatori che hanno perso ([lost]) sono ignorati.
+ *
+ *   Le teste previste sono calcolate con la direzione che
+ *   i serpenti hanno al momento della costruzione.
+ */
+void WorldModel_build(WorldModel *world, unsigned int ticks,
+                      Snake **snakes, const _Bool *lost,
+                      int player_count, Position apple)
+{
+  world->width  = Display_getWidth();
+  world->height = Display_getHeight();
+  world->player_count = player_count;
+
+  memset(world->occupied, 0, sizeof(world->occupied));
+  memset(world->blocked,  0, sizeof(world->blocked));
+  memset(world->predicted_heads, 0, sizeof(world->predicted_heads));
+  memset(world->possible_heads,  0, sizeof(world->possible_heads));
+  memset(world->free_in, 0, sizeof(world->free_in));
+  memset(world->free_owner, WORLD_NO_OWNER, sizeof(world->free_owner));
+
+  for (int i = 0; i < player_count; ++i) {
+
+    world->predicted_head[i] = -1;
+    world->moving_tail[i] = -1;
+    if (lost[i])
+      continue;
+
+    Snake *snake = snakes[i];
+
+    // La coda si libera al prossimo update, a meno
+    // che il serpente non stia per crescere.
+    unsigned int blocked_size = Snake_getSize(snake);
+    if (!Snake_willGrow(snake))
+      blocked_size--;
+
+    // Il blocco j-esimo a partire dalla testa si libera
+    // dopo (blocked_size - j + 1) update. Se due serpenti
+    // si sovrappongono vale il più lento a liberarsi.
+    SnakeIter iter = SnakeIter_new(snake);
+    unsigned int j = 0;
+    do {
+      int idx = WorldModel_cellIndex(world, iter.pos);
+      MASK_SET(world->occupied, idx);
+      if (j < blocked_size)
+        MASK_SET(world->blocked, idx);
+      if (world->free_in[idx] < blocked_size - j + 1) {
+        world->free_in[idx] = blocked_size - j + 1;
+        world->free_owner[idx] = i;
+      }
+      j++;
+    } while (SnakeIter_next(&iter));
+
+    if (!Snake_willGrow(snake))
+      world->moving_tail[i] = WorldModel_cellIndex(world, Snake_getTailPosition(snake));
+
+    Position head = WorldModel_getNeighbour(world, Snake_getHeadPosition(snake),
+                                            Snake_getDirection(snake));
+    int idx = WorldModel_cellIndex(world, head);
+    world->predicted_head[i] = idx;
+    MASK_SET(world->predicted_heads, idx);
+  }
+
+  // Le direzioni sicure si possono calcolare solo dopo
+  // aver inserito tutti i serpenti e tutte le teste.
+  for (int i = 0; i < player_count; ++i) {
+
+    world->safe_directions[i] = 0;
+    world->cautious_directions[i] = 0;
+    if (lost[i])
+      continue;
+
+    // [Snake_changeDirection] ignora l'inversione di marcia,
+    // quindi chiederla vuol dire andare dritto: non è mai
+    // una delle direzioni sicure, nemmeno per un serpente
+    // lungo 1 che non ha il collo alle spalle.
+    Position  head    = Snake_getHeadPosition(snakes[i]);
+    Direction reverse = oppositeDirection(Snake_getDirection(snakes[i]));
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+      if (dir == reverse)
+        continue;
+      Position next = WorldModel_getNeighbour(world, head, dir);
+      if (WorldModel_isBlocked(world, next) ||
+          WorldModel_isOpponentHeadAt(world, i, next))
+        continue;
+
+      int idx = WorldModel_cellIndex(world, next);
+      _Bool tail = 0;
+      for (int j = i + 1; j < player_count && !tail; ++j)
+        tail = world->moving_tail[j] == idx;
+      if (!tail)
+        world->safe_directions[i] |= 1 << dir;
+    }
+
+    // A questo punto [possible_heads] contiene le teste
+    // possibili dei giocatori che si muovono prima di [i].
+    // Le teste possibili di [i] sono al più 3 celle: la
+    // cella alle spalle non conta, altrimenti i giocatori
+    // successivi la eviterebbero senza motivo.
+    unsigned int moves = world->safe_directions[i] & ~(1u << reverse);
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir) {
+      if (!((moves >> dir) & 1))
+        continue;
+      int idx = WorldModel_cellIndex(world, WorldModel_getNeighbour(world, head, dir));
+      if (!MASK_TEST(world->possible_heads, idx))
+        world->cautious_directions[i] |= 1 << dir;
+    }
+    for (Direction dir = DIR_LEFT; dir <= DIR_DOWN; ++dir)
+      if ((moves >> dir) & 1)
+        MASK_SET(world->possible_heads,
+                 WorldModel_cellIndex(world, WorldModel_getNeighbour(world, head, dir)));
+  }
+
+  const int cells = world->width * world->height;
+  unsigned int occupied = 0;
+  for (int i = 0; i < (cells + 31) / 32; ++i)
+    occupied += __builtin_popcount(world->occupied[i]);
+  world->free_cells = cells - occupied;
+
+  WorldModel_computeAppleDistance(world, apple);
+  WorldModel_computeTerritory(world, snakes, lost);
+
+  world->ticks = ticks;
+  world->valid = 1;
+}
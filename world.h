@@ -0,0 +1,147 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <stdint.h>
+#include "utils.h"
+#include "config.h"
+
+#define WORLD_MASK_WORDS ((MAX_BOARD_CELLS + 31) / 32)
+#define WORLD_UNREACHABLE 0xFFFF
+
+// Valori di [territory_owner] per le celle che non
+// appartengono a nessun giocatore.
+#define WORLD_NO_OWNER    0xFF
+#define WORLD_CONTESTED   0xFE
+
+struct Snake;
+
+/* Symbol: WorldModel
+ *   Fotografia dello stato di una partita ad un certo tick,
+ *   pensata per i giocatori artificiali. La partita ne
+ *   possiede una sola istanza che viene ricalcolata al più
+ *   una volta per tick (vedi [Game_getWorldModel]) e che
+ *   tutti i giocatori leggono senza modificarla, così che
+ *   il costo di scandire i serpenti non cresca col numero
+ *   di giocatori artificiali.
+ *
+ *   Le celle sono indicizzate come (y * width + x). Gli
+ *   insiemi di celle sono rappresentati come bitmask.
+ *
+ *     occupied        - celle occupate da un serpente
+ *                       ancora in gioco.
+ *     blocked         - celle che saranno ancora occupate
+ *                       dopo il prossimo update, cioè
+ *                       [occupied] senza le code che si
+ *                       sposteranno.
+ *     predicted_heads - posizioni delle teste al prossimo
+ *                       update assumendo che nessuno cambi
+ *                       direzione.
+ *     safe_directions - per ogni giocatore, una maschera di
+ *                       4 bit (il bit [dir] per ogni valore
+ *                       di [Direction]) delle direzioni che
+ *                       non lo fanno perdere al prossimo
+ *                       update, esclusa l'inversione di
+ *                       marcia. [Game_update] muove i
+ *                       serpenti in ordine di giocatore,
+ *                       quindi le code dei giocatori
+ *                       successivi sono ancora al loro
+ *                       posto quando si muove la testa.
+ *     possible_heads  - celle in cui può entrare la testa di
+ *                       almeno un giocatore al prossimo
+ *                       update, con una qualunque delle sue
+ *                       direzioni sicure (mai con
+ *                       l'inversione di marcia).
+ *     cautious_directions - per ogni giocatore, le direzioni
+ *                       sicure che portano in celle in cui
+ *                       nessun avversario che si muove prima
+ *                       di lui può entrare, anche cambiando
+ *                       direzione. Gli avversari che si
+ *                       muovono dopo perderebbero entrando
+ *                       nella sua testa, quindi non sono un
+ *                       pericolo.
+ *     free_in         - per ogni cella, fra quanti update
+ *                       sarà libera: una cella con
+ *                       free_in <= d può essere occupata
+ *                       dalla testa al d-esimo update da
+ *                       ora (assumendo che nessun serpente
+ *                       mangi la mela nel frattempo). Vale
+ *                       0 per le celle già libere.
+ *     free_owner      - per ogni cella occupata, il
+ *                       giocatore da cui dipende [free_in]
+ *                       (WORLD_NO_OWNER per quelle libere).
+ *     free_cells      - numero di celle non occupate.
+ *     apple_distance  - distanza minima (in passi) di ogni
+ *                       cella dalla mela, passando solo per
+ *                       celle non bloccate. Vale
+ *                       WORLD_UNREACHABLE per le celle da
+ *                       cui la mela non è raggiungibile.
+ *     territory_owner - giocatore che raggiunge per primo
+ *                       ogni cella (diagramma di Voronoi
+ *                       sulla griglia), WORLD_CONTESTED se
+ *                       più giocatori la raggiungono insieme
+ *                       o WORLD_NO_OWNER se nessuno la
+ *                       raggiunge (vedi
+ *                       [WorldModel_computeTerritory]).
+ *     territory       - numero di celle di ogni giocatore
+ *                       in [territory_owner], in totale e
+ *                       per ognuna delle sue prime mosse.
+ */
+typedef struct {
+  _Bool        valid;
+  unsigned int ticks;
+  int          width;
+  int          height;
+
+  uint32_t occupied[WORLD_MASK_WORDS];
+  uint32_t blocked[WORLD_MASK_WORDS];
+  uint32_t predicted_heads[WORLD_MASK_WORDS];
+  uint32_t possible_heads[WORLD_MASK_WORDS];
+
+  // Cella della testa prevista di ciascun giocatore,
+  // oppure -1 per i giocatori che hanno perso.
+  int predicted_head[MAX_PLAYERS_PER_GAME];
+  int player_count;
+
+  // Cella della coda di ciascun giocatore se si libera
+  // al prossimo update, altrimenti -1.
+  int moving_tail[MAX_PLAYERS_PER_GAME];
+
+  uint8_t safe_directions[MAX_PLAYERS_PER_GAME];
+  uint8_t cautious_directions[MAX_PLAYERS_PER_GAME];
+
+  uint16_t free_in[MAX_BOARD_CELLS];
+  uint8_t  free_owner[MAX_BOARD_CELLS];
+  unsigned int free_cells;
+  uint16_t apple_distance[MAX_BOARD_CELLS];
+
+  uint8_t  territory_owner[MAX_BOARD_CELLS];
+  // Prime mosse (bit [dir]) del proprietario che
+  // raggiungono la cella per prime.
+  uint8_t  territory_moves[MAX_BOARD_CELLS];
+  uint16_t territory_distance[MAX_BOARD_CELLS];
+  uint16_t territory[MAX_PLAYERS_PER_GAME];
+  uint16_t move_territory[MAX_PLAYERS_PER_GAME][4];
+
+  // Coda usata dalla BFS durante la costruzione.
+  Position bfs_queue[MAX_BOARD_CELLS];
+} WorldModel;
+
+void         WorldModel_invalidate(WorldModel *world);
+void         WorldModel_build(WorldModel *world, unsigned int ticks,
+                              struct Snake **snakes, const _Bool *lost,
+                              int player_count, Position apple);
+int          WorldModel_cellIndex(const WorldModel *world, Position pos);
+_Bool        WorldModel_isOccupied(const WorldModel *world, Position pos);
+_Bool        WorldModel_isBlocked(const WorldModel *world, Position pos);
+_Bool        WorldModel_isOpponentHeadAt(const WorldModel *world, int player, Position pos);
+unsigned int WorldModel_getAppleDistance(const WorldModel *world, Position pos);
+unsigned int WorldModel_getSafeDirections(const WorldModel *world, int player);
+unsigned int WorldModel_getCautiousDirections(const WorldModel *world, int player);
+unsigned int WorldModel_getFreeIn(const WorldModel *world, Position pos);
+unsigned int WorldModel_getFreeCells(const WorldModel *world);
+unsigned int WorldModel_getAlivePlayers(const WorldModel *world);
+Position     WorldModel_getNeighbour(const WorldModel *world, Position pos, Direction dir);
+unsigned int WorldModel_getTerritory(const WorldModel *world, int player);
+unsigned int WorldModel_getMoveTerritory(const WorldModel *world, int player, Direction dir);
+
+#endif /* WORLD_H */